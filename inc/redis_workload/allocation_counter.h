@@ -0,0 +1,30 @@
+/**
+ * @file redis_workload/allocation_counter.h
+ *
+ * @brief Per-thread heap allocation counting for the request path
+ *
+ * Counting is compiled in only when COUNT_ALLOCATIONS is defined, in which
+ * case every replaceable global operator new, including the array, nothrow
+ * and aligned forms, is replaced by a counting version. Direct malloc calls,
+ * as made by hiredis, are not counted. Without COUNT_ALLOCATIONS the
+ * counter always reads zero.
+ */
+#pragma once
+
+namespace redis_store {
+
+/**
+ * Return the number of operator new calls made by the calling thread.
+ *
+ * @return the allocation count, 0 when counting is not compiled in
+ */
+unsigned long long getThreadAllocationCount();
+
+/**
+ * Return whether the build counts allocations.
+ *
+ * @return true when compiled with COUNT_ALLOCATIONS
+ */
+bool allocationCountingEnabled();
+
+}  // namespace redis_store
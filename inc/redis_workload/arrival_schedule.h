@@ -0,0 +1,69 @@
+/**
+ * @file redis_workload/arrival_schedule.h
+ *
+ * @brief Intended send times of an open-loop load generator
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace query_runner {
+
+enum class ArrivalDistribution
+{
+    fixed,
+    poisson
+};
+
+/**
+ * Parse an arrival distribution name.
+ *
+ * @param name "fixed" or "poisson"
+ * @throws std::runtime_error for an unknown name.
+ * @return the arrival distribution
+ */
+ArrivalDistribution arrivalDistributionFromString(const std::string& name);
+
+std::string arrivalDistributionToString(ArrivalDistribution distribution);
+
+/**
+ * Sequence of arrival times, as offsets from the start of a run, for a
+ * target request rate.
+ *
+ * Fixed arrivals are evenly spaced. Poisson arrivals have exponentially
+ * distributed gaps with the same mean, so independent schedules of
+ * several runners add up to a Poisson stream at the combined rate.
+ */
+class ArrivalSchedule {
+private:
+    double intervalNanos_;
+    ArrivalDistribution distribution_;
+    std::mt19937_64 generator_;
+    std::exponential_distribution<double> gapDistribution_;
+    double nextArrivalNanos_;
+
+    double nextGapNanos();
+
+public:
+    /**
+     * @param ratePerSecond the target arrival rate, must be positive
+     * @param distribution the distribution of the gaps between arrivals
+     * @param seed the random seed of Poisson arrivals
+     * @param phase fraction of a mean gap, in [0, 1), by which fixed
+     *        arrivals are delayed so that runners sharing a rate do not
+     *        send in lockstep
+     */
+    ArrivalSchedule(double ratePerSecond, ArrivalDistribution distribution, uint64_t seed, double phase = 0.0);
+
+    /**
+     * Return the next arrival time and advance the schedule.
+     *
+     * @return the arrival time as an offset from the start of the run
+     */
+    std::chrono::nanoseconds next();
+};
+
+}  // namespace query_runner
@@ -0,0 +1,97 @@
+/**
+ * @file redis_workload/capacity_search.h
+ *
+ * @brief Search for the highest load whose p99 stays within an SLO
+ */
+#pragma once
+
+#include <json/json.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * One run of a capacity search at a given offered load.
+ */
+struct capacity_probe_t {
+    // Thread count or open-loop rate of the run
+    double load = 0.0;
+    double queriesPerSecond = 0.0;
+    int64_t p50Micro = 0;
+    int64_t p99Micro = 0;
+    bool withinSlo = false;
+};
+
+/**
+ * Finds the highest offered load whose p99 query time is within an SLO.
+ *
+ * The load is doubled from the start load until a run misses the SLO or
+ * the maximum load is reached, then the range between the highest passing
+ * and lowest failing load is bisected. Integer loads, such as thread
+ * counts, are bisected down to adjacent values, others down to the
+ * precision relative to the failing load. If the start load misses the
+ * SLO the search stops there, with no capacity.
+ */
+class CapacitySearch {
+public:
+    // Runs of one search at most, so a noisy knee cannot bisect forever
+    static constexpr size_t kMaxProbes = 32;
+
+private:
+    int64_t p99SloMicro_;
+    double startLoad_;
+    double maxLoad_;
+    bool integerLoad_;
+    double precision_;
+    std::string loadName_;
+
+    std::vector<capacity_probe_t> probes_;
+
+public:
+    CapacitySearch() = delete;
+
+    /**
+     * @param p99SloMicro the p99 query time a load must stay within
+     * @param startLoad the first load run
+     * @param maxLoad the highest load run
+     * @param integerLoad true to run whole loads only
+     * @param precision the relative width of the final range for
+     *        fractional loads, for example 0.05
+     * @param loadName the name of the load in reports, for example "threads"
+     */
+    CapacitySearch(int64_t p99SloMicro, double startLoad, double maxLoad, bool integerLoad, double precision, const std::string& loadName);
+
+    /**
+     * Run the search.
+     *
+     * @param probe runs the workload at a load and returns its throughput
+     *        and percentiles, the load and SLO result are filled in by the
+     *        search
+     */
+    void run(const std::function<capacity_probe_t(double load)>& probe);
+
+    /**
+     * @return the runs of the search, in the order they ran
+     */
+    const std::vector<capacity_probe_t>& getProbes() const;
+
+    /**
+     * @return the run at the highest load within the SLO, null if every
+     *         run missed it
+     */
+    const capacity_probe_t* getCapacity() const;
+
+    /**
+     * Format the latency curve, the runs ordered by load, and the capacity.
+     */
+    std::string toString() const;
+
+    Json::Value toJson() const;
+};
+
+}  // namespace query_runner
@@ -0,0 +1,89 @@
+/**
+ * @file redis_workload/cluster_topology.h
+ *
+ * @brief Hashslot to node ownership map of a Redis Cluster
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace redis_store {
+
+/**
+ * A primary node of a Redis Cluster.
+ */
+struct cluster_node_t {
+    std::string id;
+    std::string host;
+    int port;
+    // A hashtag that hashes to a slot owned by this node, used to address
+    // the node through AsyncRedisCluster::redis(hashtag)
+    std::string hashtag;
+    size_t slotCount;
+};
+
+/**
+ * Snapshot of which primary node owns each Redis hashslot.
+ */
+class ClusterTopology {
+public:
+    static constexpr size_t kHashslotCount = 16384;
+    static constexpr uint16_t kUnassignedNode = UINT16_MAX;
+
+private:
+    std::vector<cluster_node_t> nodes_;
+    std::vector<uint16_t> slotNodes_;
+
+    void assignHashtags();
+
+public:
+    ClusterTopology();
+
+    /**
+     * Build the topology from the reply to CLUSTER NODES. Only primary
+     * nodes that own hashslots are included. Slots being imported or
+     * migrated are owned by the node listing them as a plain range.
+     *
+     * @param clusterNodes the CLUSTER NODES reply text
+     *
+     * @throws std::runtime_error for a malformed reply.
+     *
+     * @return the topology
+     */
+    static ClusterTopology fromClusterNodes(std::string_view clusterNodes);
+
+    [[nodiscard]] size_t getNodeCount() const {
+        return nodes_.size();
+    }
+
+    [[nodiscard]] const cluster_node_t& getNode(uint16_t node) const {
+        return nodes_[node];
+    }
+
+    /**
+     * Return the index of the node that owns a hashslot.
+     *
+     * @param hashslot the Redis hashslot
+     *
+     * @return the node index, kUnassignedNode if no node owns the slot
+     */
+    [[nodiscard]] uint16_t getNodeForHashslot(uint16_t hashslot) const {
+        return slotNodes_[hashslot];
+    }
+
+    /**
+     * Return the number of hashslots not owned by any node.
+     */
+    [[nodiscard]] size_t getUnassignedSlotCount() const;
+
+    /**
+     * Describe the nodes and the number of slots they own, one per line.
+     */
+    [[nodiscard]] std::string toString() const;
+};
+
+}  // namespace redis_store
@@ -0,0 +1,188 @@
+/**
+ * @file redis_workload/coroutine_executor.h
+ *
+ * @brief Thread pool resuming C++20 coroutines, and the awaitable Redis fetch
+ *        used by virtual clients
+ */
+#pragma once
+
+#include <redis_workload/datatypes.h>
+#include <redis_workload/redis_store.h>
+
+#include <boost/thread.hpp>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * Fixed pool of threads resuming ready coroutines in FIFO order.
+ *
+ * Coroutines suspended on a Redis fetch are scheduled back onto the pool by
+ * the fetch completion, so any number of coroutines share the pool threads.
+ */
+class CoroutineExecutor {
+private:
+    std::mutex mutex_;
+    std::condition_variable readyCondition_;
+    std::deque<std::coroutine_handle<>> readyQueue_;
+    bool stopping_ = false;
+    std::vector<boost::thread> threads_;
+
+    void work();
+
+public:
+    /**
+     * Start the pool threads.
+     *
+     * @param threadCount the number of threads, 0 for one per hardware thread
+     */
+    explicit CoroutineExecutor(unsigned int threadCount);
+
+    CoroutineExecutor(const CoroutineExecutor&) = delete;
+    CoroutineExecutor& operator=(const CoroutineExecutor&) = delete;
+
+    /**
+     * Stop the pool threads once the queued coroutines have run.
+     */
+    ~CoroutineExecutor();
+
+    /**
+     * Queue a suspended coroutine to be resumed on a pool thread.
+     *
+     * @param handle the coroutine to resume
+     */
+    void schedule(std::coroutine_handle<> handle);
+
+    [[nodiscard]] unsigned int getThreadCount() const {
+        return (unsigned int)threads_.size();
+    }
+
+    /**
+     * Awaitable that moves the awaiting coroutine onto a pool thread.
+     */
+    struct ScheduleAwaitable {
+        CoroutineExecutor& executor;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            executor.schedule(handle);
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    ScheduleAwaitable resumeOnPool() {
+        return {*this};
+    }
+};
+
+/**
+ * Fire and forget coroutine. The coroutine starts suspended, is destroyed
+ * when it returns, and reports its completion through onComplete.
+ */
+struct VirtualClientTask {
+    struct promise_type {
+        std::function<void(std::exception_ptr)> onComplete;
+        std::exception_ptr error;
+
+        VirtualClientTask get_return_object() {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        /**
+         * Report completion from the final suspend point, after which the
+         * frame is destroyed.
+         */
+        struct FinalAwaitable {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                std::function<void(std::exception_ptr)> onComplete = std::move(handle.promise().onComplete);
+                std::exception_ptr error = handle.promise().error;
+                handle.destroy();
+                if (onComplete) {
+                    onComplete(error);
+                }
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        FinalAwaitable final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    /**
+     * Schedule the coroutine to start on the executor.
+     *
+     * @param executor the pool the coroutine runs on
+     * @param onComplete called with any uncaught exception when the coroutine returns
+     */
+    void start(CoroutineExecutor& executor, std::function<void(std::exception_ptr)> onComplete) {
+        handle.promise().onComplete = std::move(onComplete);
+        executor.schedule(handle);
+    }
+};
+
+/**
+ * Awaitable asynchronous fetch. The awaiting coroutine is suspended while
+ * the MGETs are in flight and resumed on the executor with the number of
+ * objects fetched. A fetch error is rethrown in the coroutine.
+ */
+class FetchAwaitable {
+private:
+    redis_store::RedisDataStore& dataStore_;
+    const redis_store::vector_hashslot_keys_t& keys_;
+    CoroutineExecutor& executor_;
+    size_t fetchedCount_ = 0;
+    size_t fetchedBytes_ = 0;
+    std::exception_ptr error_;
+
+public:
+    FetchAwaitable(redis_store::RedisDataStore& dataStore, const redis_store::vector_hashslot_keys_t& keys, CoroutineExecutor& executor) :
+        dataStore_(dataStore),
+        keys_(keys),
+        executor_(executor) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    size_t await_resume();
+
+    /**
+     * @return the bytes of the values fetched, once resumed
+     */
+    [[nodiscard]] size_t getFetchedBytes() const {
+        return fetchedBytes_;
+    }
+};
+
+}  // namespace query_runner
@@ -0,0 +1,79 @@
+/**
+ * @file redis_workload/cpu_affinity.h
+ *
+ * @brief CPU lists, NUMA nodes and thread CPU affinity
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace redis_store {
+
+/**
+ * Parse a CPU list in the format of taskset and /sys, for example
+ * "0-3,8,10-11".
+ *
+ * @param cpuList the CPU list
+ * @return the CPUs in the order listed
+ * @throws std::invalid_argument if the list is malformed.
+ */
+std::vector<int> parseCpuList(const std::string& cpuList);
+
+/**
+ * Format CPUs as a CPU list, joining consecutive CPUs into ranges.
+ *
+ * @param cpus the CPUs
+ * @return the CPU list, for example "0-3,8"
+ */
+std::string formatCpuList(const std::vector<int>& cpus);
+
+/**
+ * Restrict the calling thread to the given CPUs. Threads the calling
+ * thread starts afterwards inherit the restriction.
+ *
+ * @param cpus the CPUs, empty to allow every CPU
+ * @throws std::runtime_error if the affinity cannot be set.
+ */
+void setThreadAffinity(const std::vector<int>& cpus);
+
+/**
+ * @return the CPUs the calling thread may run on
+ */
+std::vector<int> getThreadAffinity();
+
+/**
+ * Return the CPUs of a NUMA node, as listed in /sys/devices/system/node.
+ *
+ * @param node the NUMA node
+ * @return the CPUs of the node, empty if the node is unknown
+ */
+std::vector<int> getNumaNodeCpus(int node);
+
+/**
+ * @return the online NUMA nodes, empty if the system does not report them
+ */
+std::vector<int> getNumaNodes();
+
+/**
+ * Return the NUMA nodes the given CPUs belong to.
+ *
+ * @param cpus the CPUs
+ * @return the nodes, in ascending order, empty if unknown
+ */
+std::vector<int> getNumaNodesOfCpus(const std::vector<int>& cpus);
+
+/**
+ * Parse a placement: the CPU sets threads are pinned to, the i-th thread
+ * to set i modulo the number of sets. A CPU list gives one set per CPU,
+ * "node:" followed by a list of NUMA nodes gives one set per node, with
+ * all the CPUs of the node.
+ *
+ * @param placement for example "0-7" or "node:0,1"
+ * @return the CPU sets
+ * @throws std::invalid_argument if the placement is malformed or names a
+ *         NUMA node without CPUs.
+ */
+std::vector<std::vector<int>> parseCpuPlacement(const std::string& placement);
+
+}  // namespace redis_store
@@ -0,0 +1,46 @@
+/**
+ * @file redis_workload/crc16.h
+ *
+ * @brief Lock-free CRC16 implementations matching the Redis hashslot CRC
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace redis_store {
+
+/**
+ * Calculate the Redis CRC16 (XMODEM: polynomial 0x1021, no reflection,
+ * initial value 0) using slicing-by-8 lookup tables.
+ *
+ * @param data the bytes to checksum
+ * @param length the number of bytes
+ * @param crc the CRC of any preceding bytes, 0 for a new checksum
+ *
+ * @return the checksum value
+ */
+uint16_t crc16SliceBy8(const char* data, size_t length, uint16_t crc = 0);
+
+/**
+ * Calculate the Redis CRC16 by folding 16-byte blocks with carry-less
+ * multiplication. Inputs shorter than two blocks use the slicing-by-8
+ * tables.
+ *
+ * Must only be called when crc16ClmulSupported() returns true.
+ *
+ * @param data the bytes to checksum
+ * @param length the number of bytes
+ *
+ * @return the checksum value
+ */
+uint16_t crc16Clmul(const char* data, size_t length);
+
+/**
+ * Check whether the CPU supports the instructions used by crc16Clmul.
+ *
+ * @return true if crc16Clmul may be called.
+ */
+bool crc16ClmulSupported();
+
+}  // namespace redis_store
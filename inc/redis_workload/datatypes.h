@@ -10,10 +10,15 @@
 #include <sw/redis++/async_redis_cluster.h>
 
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
 #include <boost/functional/hash.hpp>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -40,15 +45,48 @@ typedef as_hashmap_t<std::string, std::shared_ptr<std::string>> fetch_by_string_
  */
 typedef std::vector<std::string> vector_keys_t;
 
+/**
+ * Vector of object keys that reference storage owned elsewhere, for example
+ * a memory mapped workload file.
+ */
+typedef std::vector<std::string_view> vector_key_views_t;
+
+/**
+ * Redis key together with its precomputed hashslot.
+ * Ordering and equality only consider the key, the hashslot is derived
+ * from it.
+ */
+struct hashslot_key_t {
+    std::string_view key;
+    uint16_t hashslot;
+
+    bool operator<(const hashslot_key_t& other) const {
+        return key < other.key;
+    }
+
+    bool operator==(const hashslot_key_t& other) const {
+        return key == other.key;
+    }
+};
+
+/**
+ * Vector of object keys with precomputed hashslots.
+ */
+typedef std::vector<hashslot_key_t> vector_hashslot_keys_t;
+
 /**
  * Vector of redis result objects
  */
 typedef std::vector<sw::redis::OptionalString> vector_results_t;
 
 /**
- * Map of Redis hashslot ID to redis key strings
+ * Redis keys that all hash to a single Redis hashslot. The keys are a view
+ * into storage owned by a HashslotKeyGroups instance.
  */
-typedef std::map<uint16_t, vector_keys_t> hashslot_key_groups_t;
+struct hashslot_key_group_t {
+    uint16_t hashslot;
+    std::span<const std::string_view> keys;
+};
 
 /**
  * Map of Redis key to optional string for raw results obtained from Redis
@@ -56,18 +94,25 @@ typedef std::map<uint16_t, vector_keys_t> hashslot_key_groups_t;
 typedef as_hashmap_t<std::string, sw::redis::OptionalString> multiget_result_map_t;
 
 /*
- * For Async operations, the map contains the pair
- * vector<keys>:future<vector<optionalstring>> The order of keys corresponds to
- * the order of optionalstrings. Using a vector as the key to an unordered_map
- * requires a custom hash function to be defined.
+ * For Async operations, each MGET slice holds the pair
+ * span<keys>:future<vector<optionalstring>> The order of keys corresponds to
+ * the order of optionalstrings.
  */
 typedef sw::redis::Future<std::vector<sw::redis::OptionalString>> async_multiget_future_result_t;
-class VectorStringHasher {
-public:
-    size_t operator()(const vector_keys_t& v) const {
-        return boost::hash_value(v);
-    }
+struct mget_future_slice_t {
+    std::span<const std::string_view> keys;
+    async_multiget_future_result_t future;
+    // Sent directly to the owning node rather than through the cluster client
+    bool sentToNode;
+    std::chrono::steady_clock::time_point issueTime;
 };
-typedef std::unordered_map<vector_keys_t, std::shared_ptr<async_multiget_future_result_t>, VectorStringHasher> mgetFutureResultMap;
+typedef std::vector<mget_future_slice_t> mget_future_slices_t;
+
+/**
+ * Completion callback of an asynchronous fetch. results holds one entry per
+ * requested key, in request order. error is set when any MGET failed, in
+ * which case the entries of the failed MGETs hold no value.
+ */
+typedef std::function<void(vector_results_t& results, std::exception_ptr error)> fetch_callback_t;
 
 }  // namespace redis_store
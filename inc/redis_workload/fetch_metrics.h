@@ -0,0 +1,178 @@
+/**
+ * @file redis_workload/fetch_metrics.h
+ *
+ * @brief Per-thread counters of the MGET slices issued by fetches
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace redis_store {
+
+/**
+ * Stages of a blocking fetch, in the order they first run. Waiting and
+ * collecting alternate as each MGET slice is collected.
+ *     group     remove duplicate keys and group the keys by hashslot
+ *     issue     send the MGETs
+ *     wait      wait for the MGET replies
+ *     collect   move the replies into the caller's results
+ */
+enum class FetchStage
+{
+    group,
+    issue,
+    wait,
+    collect
+};
+
+static constexpr size_t kFetchStageCount = 4;
+
+const char* fetchStageToString(FetchStage stage);
+
+/**
+ * MGET slice statistics for the fetches made by one thread.
+ *
+ * Slices are bucketed by key count in powers of two, so the latency of
+ * small and large MGETs can be compared when choosing maxMultiKeyBatchSize.
+ * A slice latency runs from issuing the MGET to collecting its result,
+ * which includes any wait for earlier slices of the same fetch.
+ */
+class FetchMetrics {
+public:
+    // Buckets hold slices of 1, 2-3, 4-7, ... keys, the last bucket is open ended
+    static constexpr size_t kSliceSizeBuckets = 10;
+
+private:
+    unsigned long long fetchCount_ = 0;
+    unsigned long long keyCount_ = 0;
+    unsigned long long roundTripCount_ = 0;
+    unsigned long long sliceCount_ = 0;
+    unsigned long long maxSliceKeys_ = 0;
+    std::array<unsigned long long, kSliceSizeBuckets> bucketSliceCounts_ {};
+    std::array<unsigned long long, kSliceSizeBuckets> bucketKeyCounts_ {};
+    std::array<unsigned long long, kSliceSizeBuckets> bucketLatencyMicro_ {};
+    std::array<unsigned long long, kSliceSizeBuckets> bucketMaxLatencyMicro_ {};
+    unsigned long long stageTimedFetchCount_ = 0;
+    std::array<unsigned long long, kFetchStageCount> stageNanos_ {};
+
+    static size_t getSliceSizeBucket(size_t keys);
+
+public:
+    /**
+     * Record a fetch.
+     *
+     * @param keys the number of distinct keys fetched
+     * @param roundTrips the number of MGETs, or of node pipelines when
+     *        MGETs are batched by node, the fetch waited for
+     */
+    void addFetch(size_t keys, size_t roundTrips);
+
+    /**
+     * Record a completed MGET slice.
+     *
+     * @param keys the number of keys in the slice
+     * @param latencyMicro microseconds from issuing the MGET to its result
+     */
+    void addSlice(size_t keys, long long latencyMicro);
+
+    /**
+     * Record the start of a fetch timed by stage.
+     */
+    void addStageTimedFetch();
+
+    /**
+     * Record time spent in a stage of a timed fetch.
+     *
+     * @param stage the fetch stage
+     * @param nanos nanoseconds spent in the stage
+     */
+    void addStageTime(FetchStage stage, long long nanos);
+
+    /**
+     * Add the counts of another instance to this one.
+     */
+    void merge(const FetchMetrics& other);
+
+    void reset();
+
+    [[nodiscard]] unsigned long long getFetchCount() const {
+        return fetchCount_;
+    }
+
+    [[nodiscard]] unsigned long long getSliceCount() const {
+        return sliceCount_;
+    }
+
+    [[nodiscard]] unsigned long long getRoundTripCount() const {
+        return roundTripCount_;
+    }
+
+    /**
+     * Format the statistics as report lines.
+     *
+     * @param indent prefix for every line
+     * @return the report text
+     */
+    [[nodiscard]] std::string toString(const std::string& indent) const;
+};
+
+/**
+ * Return the FetchMetrics instance of the calling thread.
+ *
+ * @return the per-thread fetch metrics
+ */
+FetchMetrics& getThreadFetchMetrics();
+
+/**
+ * Splits the time of a blocking fetch into its stages. start() begins a
+ * fetch and each lap() charges the time since the previous lap to a stage
+ * in the thread's FetchMetrics. A clock that was not started for the
+ * current fetch ignores laps, so untimed fetches cost one branch per lap.
+ */
+class FetchStageClock {
+private:
+    bool enabled_ = false;
+    std::chrono::steady_clock::time_point lapStart_;
+
+public:
+    /**
+     * Begin a fetch.
+     *
+     * @param enabled false to ignore the laps of this fetch
+     */
+    void start(bool enabled) {
+        enabled_ = enabled;
+        if (enabled_) {
+            getThreadFetchMetrics().addStageTimedFetch();
+            lapStart_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    void lap(FetchStage stage) {
+        if (!enabled_) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        getThreadFetchMetrics().addStageTime(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(now - lapStart_).count());
+        lapStart_ = now;
+    }
+
+    /**
+     * End the fetch, later laps are ignored until the next start().
+     */
+    void stop() {
+        enabled_ = false;
+    }
+};
+
+/**
+ * Return the FetchStageClock of the calling thread.
+ *
+ * @return the per-thread fetch stage clock
+ */
+FetchStageClock& getThreadFetchStageClock();
+
+}  // namespace redis_store
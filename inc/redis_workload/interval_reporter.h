@@ -0,0 +1,128 @@
+/**
+ * @file redis_workload/interval_reporter.h
+ *
+ * @brief Time series of throughput and latency while a test runs
+ */
+#pragma once
+
+#include <redis_workload/latency_histogram.h>
+#include <redis_workload/writer_reader_phaser.h>
+
+#include <array>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * Counts of the queries completed in one reporting interval.
+ */
+struct interval_counts_t {
+    unsigned long long queries = 0;
+    unsigned long long keys = 0;
+    unsigned long long bytes = 0;
+    unsigned long long errors = 0;
+};
+
+/**
+ * Double-buffered interval statistics of one runner.
+ *
+ * The runner records into the active buffer without locking, the
+ * reporter swaps the buffers and reads the one no longer written. Only one
+ * thread may record at a time, the runners serialize the completions of
+ * their asynchronous fetches and virtual clients already.
+ */
+class IntervalRecorder {
+private:
+    struct interval_t {
+        redis_store::LatencyHistogram queryTimesMicro;
+        interval_counts_t counts;
+    };
+
+    std::array<interval_t, 2> intervals_;
+    std::atomic<interval_t*> active_;
+    redis_store::WriterReaderPhaser phaser_;
+
+public:
+    IntervalRecorder();
+
+    IntervalRecorder(const IntervalRecorder&) = delete;
+    IntervalRecorder& operator=(const IntervalRecorder&) = delete;
+
+    /**
+     * Record a completed query.
+     *
+     * @param latencyMicro the query time in microseconds
+     * @param keys the number of keys queried
+     * @param bytes the number of value bytes fetched
+     * @param success false if the fetch failed
+     */
+    void recordQuery(long long latencyMicro, size_t keys, size_t bytes, bool success);
+
+    /**
+     * Add the queries recorded since the previous sample to queryTimes and
+     * counts, and start a new interval.
+     */
+    void sampleInterval(redis_store::LatencyHistogram& queryTimes, interval_counts_t& counts);
+};
+
+/**
+ * Background thread printing the throughput and latency of the runners
+ * every interval, and optionally writing them to a CSV or JSON lines file.
+ */
+class IntervalReporter {
+private:
+    std::string runName_;
+    std::vector<std::shared_ptr<IntervalRecorder>> recorders_;
+    std::chrono::milliseconds interval_;
+    std::ofstream output_;
+    bool jsonOutput_ = false;
+
+    std::chrono::steady_clock::time_point startTime_;
+    std::chrono::steady_clock::time_point lastSampleTime_;
+
+    boost::thread thread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCondition_;
+    bool stopping_ = false;
+
+    void run();
+
+    void report();
+
+public:
+    IntervalReporter() = delete;
+
+    /**
+     * @param runName the name of the test run, written on every row
+     * @param recorders the recorders of the runners
+     * @param interval the time between rows
+     * @param outputFile CSV file, or JSON lines file for a name ending in
+     *        .json, rows are appended, empty to print to stdout only
+     *
+     * @throws std::runtime_error if the output file cannot be opened.
+     */
+    IntervalReporter(const std::string& runName,
+                     std::vector<std::shared_ptr<IntervalRecorder>> recorders,
+                     std::chrono::milliseconds interval,
+                     const std::string& outputFile);
+
+    ~IntervalReporter();
+
+    void start();
+
+    /**
+     * Stop the reporter, reporting the queries of the last partial interval.
+     */
+    void stop();
+};
+
+}  // namespace query_runner
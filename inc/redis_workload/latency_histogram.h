@@ -0,0 +1,152 @@
+/**
+ * @file redis_workload/latency_histogram.h
+ *
+ * @brief Fixed memory, mergeable latency histogram
+ */
+#pragma once
+
+#include <json/json.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace redis_store {
+
+/**
+ * Latency histogram in the layout of an HDR histogram.
+ *
+ * Values are counted in log-linear buckets: every power of two range is
+ * split into the same number of sub-buckets, so each recorded value is
+ * kept to kSignificantDigits decimal digits. Values below 2048 are kept
+ * exactly. Recording is a constant time increment and the memory used is
+ * fixed by the highest trackable value, whatever the number of values.
+ *
+ * Histograms with the same highest trackable value can be merged, and
+ * the serialized form can be merged into histograms of other processes.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSignificantDigits = 3;
+
+    // One hour in microseconds
+    static constexpr int64_t kDefaultHighestTrackableValue = 3600LL * 1000 * 1000;
+
+private:
+    int64_t highestTrackableValue_;
+    int subBucketHalfCountMagnitude_;
+    int64_t subBucketHalfCount_;
+    int64_t subBucketMask_;
+    std::vector<uint64_t> counts_;
+
+    uint64_t totalCount_ = 0;
+    int64_t minValue_ = INT64_MAX;
+    int64_t maxValue_ = 0;
+    // Sum of the recorded values, for the mean
+    long double valueSum_ = 0;
+
+    [[nodiscard]] size_t getCountsIndex(int64_t value) const;
+
+    [[nodiscard]] int64_t getValueFromIndex(size_t index) const;
+
+    [[nodiscard]] int64_t getHighestEquivalentValue(int64_t value) const;
+
+public:
+    /**
+     * @param highestTrackableValue larger values are recorded as this value
+     */
+    explicit LatencyHistogram(int64_t highestTrackableValue = kDefaultHighestTrackableValue);
+
+    /**
+     * Record a value, clamped to the range 0 to the highest trackable value.
+     *
+     * @param value the value, in microseconds for latencies
+     */
+    void recordValue(int64_t value);
+
+    /**
+     * Add the counts of another histogram to this one.
+     *
+     * @throws std::invalid_argument if the highest trackable values differ.
+     */
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    [[nodiscard]] uint64_t getTotalCount() const {
+        return totalCount_;
+    }
+
+    [[nodiscard]] int64_t getMinValue() const {
+        return (totalCount_ == 0) ? 0 : minValue_;
+    }
+
+    [[nodiscard]] int64_t getMaxValue() const {
+        return maxValue_;
+    }
+
+    [[nodiscard]] double getMean() const;
+
+    /**
+     * @return the sum of all recorded values
+     */
+    [[nodiscard]] long double getValueSum() const {
+        return valueSum_;
+    }
+
+    /**
+     * Return the value at a percentile: the highest value equivalent to
+     * the recorded value that percentile of the values are at or below.
+     * The 100th percentile is the exact maximum.
+     *
+     * @param percentile from 0 to 100
+     * @return the value, 0 for an empty histogram
+     */
+    [[nodiscard]] int64_t getValueAtPercentile(double percentile) const;
+
+    /**
+     * Return the memory used by the counts.
+     *
+     * @return the size in bytes
+     */
+    [[nodiscard]] size_t getMemoryUsage() const;
+
+    /**
+     * Serialize the histogram as a single line of text holding the non-zero
+     * counts, to be merged with histograms from other processes.
+     *
+     * @return the serialized histogram
+     */
+    [[nodiscard]] std::string serialize() const;
+
+    /**
+     * Parse a histogram written by serialize().
+     *
+     * @param text the serialized histogram
+     * @throws std::runtime_error if the text is not a serialized histogram.
+     * @return the histogram
+     */
+    static LatencyHistogram deserialize(std::string_view text);
+
+    /**
+     * Format the percentiles in the layout of the runner reports.
+     *
+     * @param indent prefix for every line
+     * @param name label of the lines, for example "run1.0 query times"
+     * @return the report text
+     */
+    [[nodiscard]] std::string toString(const std::string& indent, const std::string& name) const;
+
+    /**
+     * Summarize the histogram as JSON: the count, mean, minimum, maximum
+     * and report percentiles, along with the serialized histogram under
+     * "histogram" so results can be merged later.
+     *
+     * @return the JSON object
+     */
+    [[nodiscard]] Json::Value toJson() const;
+};
+
+}  // namespace redis_store
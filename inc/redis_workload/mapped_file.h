@@ -0,0 +1,73 @@
+/**
+ * @file redis_workload/mapped_file.h
+ *
+ * @brief Read-only memory mapping of workload input files
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace query_runner {
+
+/**
+ * Read-only view of a file mapped into the process address space.
+ *
+ * The mapping is released when the MappedFile is destroyed, so any
+ * std::string_view obtained from view() must not outlive the MappedFile.
+ */
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    void map(int fd, const std::string& name);
+
+    void unmap();
+
+public:
+    MappedFile() = default;
+
+    /**
+     * Map the named file read-only.
+     *
+     * @param filename path of the file to map
+     *
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& filename);
+
+    /**
+     * Map an already open file descriptor read-only. The descriptor is not
+     * closed, the caller keeps ownership of it.
+     *
+     * @param fd the open file descriptor
+     * @param name the name used in error messages
+     *
+     * @throws std::runtime_error if the descriptor cannot be mapped.
+     */
+    MappedFile(int fd, const std::string& name);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    [[nodiscard]] const char* data() const {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] std::string_view view() const {
+        return {data_, size_};
+    }
+};
+
+}  // namespace query_runner
@@ -1,51 +1,417 @@
 #pragma once
 
+#include <redis_workload/arrival_schedule.h>
+#include <redis_workload/coroutine_executor.h>
 #include <redis_workload/datatypes.h>
+#include <redis_workload/fetch_metrics.h>
+#include <redis_workload/interval_reporter.h>
+#include <redis_workload/latency_histogram.h>
+#include <redis_workload/query_workload.h>
 #include <redis_workload/redis_store.h>
 
+#include <atomic>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
 
 using redis_store::fetch_by_string_map_t;
 using redis_store::RedisDataStore;
+using redis_store::vector_key_views_t;
 using redis_store::vector_keys_t;
 
 namespace query_runner {
 
+/**
+ * How the queries of the process slice are shared by the runners.
+ * divide assigns every runner a fixed share before the run, replicate
+ * gives every runner all queries and dynamic hands out chunks of queries
+ * to whichever runner asks next.
+ */
 enum class OperationMode
 {
     divide,
-    replicate
+    replicate,
+    dynamic
 };
 
+/**
+ * Hands out chunks of the query indexes of a bucket shared by several
+ * runners. A runner that draws slow queries simply claims fewer chunks,
+ * so all runners finish close together.
+ */
+class QueryDispatcher {
+private:
+    std::atomic<size_t> nextQuery_ {0};
+    size_t queryCount_;
+    size_t chunkSize_;
+    bool cycle_;
+
+public:
+    QueryDispatcher() = delete;
+
+    /**
+     * @param queryCount the number of queries in the shared bucket
+     * @param chunkSize the number of consecutive queries handed out per claim
+     * @param cycle start again from the first query once every query has
+     *        been handed out, for runs bounded by a duration or query count
+     */
+    QueryDispatcher(size_t queryCount, size_t chunkSize, bool cycle = false);
+
+    /**
+     * Claim the next chunk of queries.
+     *
+     * @param begin set to the first query index of the chunk
+     * @param end set to one past the last query index of the chunk
+     * @return false when every query has been handed out, never when cycling
+     *         over a non-empty bucket
+     */
+    bool claim(size_t& begin, size_t& end);
+
+    size_t getChunkSize() const;
+};
+
+/**
+ * The query indexes one runner or virtual client works through: a fixed
+ * stride over the bucket, or chunks claimed from a shared dispatcher.
+ */
+class QueryCursor {
+private:
+    QueryDispatcher* dispatcher_ = nullptr;
+    size_t first_;
+    size_t next_;
+    size_t end_;
+    size_t stride_;
+
+    // Set by cycleUntil and setQueryLimit, the cursor then starts again
+    // from the first query until the deadline or the limit is reached
+    bool cycling_ = false;
+    std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+    size_t remaining_ = std::numeric_limits<size_t>::max();
+
+public:
+    /**
+     * Visit first, first + stride, ... up to end.
+     */
+    QueryCursor(size_t first, size_t end, size_t stride);
+
+    /**
+     * Visit the chunks claimed from the dispatcher, which must outlive the cursor.
+     */
+    explicit QueryCursor(QueryDispatcher& dispatcher);
+
+    /**
+     * Start again from the first query at the end of a fixed stride, and
+     * stop at the deadline rather than at the end of the queries. A
+     * dispatcher cursor only cycles if its dispatcher does.
+     *
+     * @param deadline no query index is returned after this time
+     */
+    void cycleUntil(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Stop after a number of queries, starting again from the first query
+     * at the end of a fixed stride as cycleUntil does.
+     *
+     * @param queryLimit the number of query indexes returned at most
+     */
+    void setQueryLimit(size_t queryLimit);
+
+    /**
+     * @param query set to the next query index
+     * @return false when no queries are left, the deadline has passed or
+     *         the query limit is reached
+     */
+    bool next(size_t& query);
+};
+
+/**
+ * Holds back the runners of a test run until all of them are ready, then
+ * releases them together with a common start time. The runners set up
+ * their buffers and wait at the gate, the thread that spawned them waits
+ * for every runner to arrive before releasing the gate, so that the
+ * measured window only starts when every runner is sending queries.
+ */
+class StartGate {
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    unsigned int runnerCount_;
+    unsigned int arrived_ = 0;
+    bool released_ = false;
+    std::chrono::steady_clock::time_point startTime_;
+
+public:
+    StartGate() = delete;
+
+    /**
+     * @param runnerCount the number of runners that wait at the gate
+     */
+    explicit StartGate(unsigned int runnerCount);
+
+    /**
+     * Called by a runner once it is ready: wait until the gate is released.
+     *
+     * @return the common start time
+     */
+    std::chrono::steady_clock::time_point arriveAndWait();
+
+    /**
+     * Wait until every runner has arrived at the gate.
+     */
+    void waitForRunners();
+
+    /**
+     * Release the runners waiting at the gate, and any that arrive later.
+     *
+     * @return the common start time
+     */
+    std::chrono::steady_clock::time_point release();
+};
+
+/**
+ * Result collection used by the runners: the key indexed result map or the
+ * result vector aligned with the query keys.
+ */
+enum class ResultApi
+{
+    map,
+    vector
+};
+
+/**
+ * Parse a result API name.
+ *
+ * @param name "map" or "vector"
+ * @throws std::runtime_error for an unknown name.
+ * @return the result API
+ */
+ResultApi resultApiFromString(const std::string& name);
+
+std::string resultApiToString(ResultApi resultApi);
+
+/**
+ * Keys found on a newline aligned region of the CSV file.
+ * queryKeyCounts holds the number of keys for each query, in file order,
+ * and queryTimes the time of each query when the file has a time column.
+ */
+struct ParsedCsvChunk {
+    vector_key_views_t keys;
+    std::vector<uint32_t> queryKeyCounts;
+    std::vector<int64_t> queryTimes;
+};
+
+/**
+ * Parse a query time field, seconds since the epoch with an optional
+ * fraction such as 1697040000.123456. Digits beyond microseconds are
+ * ignored.
+ *
+ * @param field the time field of a CSV line
+ * @throws std::runtime_error if the field is not a time.
+ * @return the time in microseconds
+ */
+int64_t parseQueryTime(std::string_view field);
+
 class QueryListCollector {
 private:
-    std::unordered_map<unsigned int, std::vector<vector_keys_t>> queryBuckets_;
+    std::shared_ptr<const QueryWorkload> workload_;
     unsigned int bucketCount_;
     OperationMode mode_;
+    unsigned int processIndex_ = 0;
+    unsigned int processCount_ = 1;
+    bool csvQueryTimes_ = false;
+
+    static ParsedCsvChunk parseCsvChunk(std::string_view chunk, bool queryTimes);
+
+    static std::vector<std::string_view> splitIntoChunks(std::string_view data, unsigned int chunkCount);
+
+    static std::shared_ptr<const QueryWorkload> parseCsvWorkload(const std::string& filename, unsigned int parseThreadCount, bool queryTimes);
 
-    void initializeBuckets();
+    static std::shared_ptr<const QueryWorkload> loadWorkload(const std::string& filename, unsigned int parseThreadCount, bool queryTimes);
+
+    void printWorkloadSummary();
 
 public:
     QueryListCollector() = delete;
 
     QueryListCollector(unsigned int bucketCount, OperationMode mode);
 
-    void parseCsvIntoBuckets(const std::string& filename);
+    /**
+     * Read the first column of CSV files as the time each query was sent,
+     * see parseQueryTime, rather than as a key. Binary files record
+     * whether they hold query times.
+     *
+     * @param queryTimes true if CSV files start with a time column
+     */
+    void setCsvQueryTimes(bool queryTimes);
+
+    /**
+     * Map the CSV file into memory, split it into queries in place and
+     * intern the keys into a single shared QueryWorkload.
+     *
+     * With parseThreadCount > 1 the file is split into newline aligned
+     * chunks that are parsed concurrently. Query order, and therefore
+     * bucket assignment, is the same as for a single threaded parse.
+     *
+     * @param filename the CSV workload file
+     * @param parseThreadCount number of threads used to parse the file
+     */
+    void parseCsvIntoBuckets(const std::string& filename, unsigned int parseThreadCount = 1);
+
+    /**
+     * Memory map a binary workload file, as written by
+     * compile_redis_workload, and use it in place. Keys and hashslots are
+     * read directly from the mapping.
+     *
+     * @param filename the binary workload file
+     */
+    void loadBinaryIntoBuckets(const std::string& filename);
+
+    /**
+     * Load a workload file, choosing the binary or CSV loader from the
+     * file contents.
+     *
+     * @param filename the binary or CSV workload file
+     * @param parseThreadCount number of threads used to parse a CSV file
+     */
+    void loadIntoBuckets(const std::string& filename, unsigned int parseThreadCount = 1);
+
+    /**
+     * Load a workload file through a named shared memory segment, so that
+     * all processes running the same workload share one read-only copy.
+     * The first process to open the segment loads the file and publishes
+     * it, the others attach to the published copy.
+     *
+     * @param filename the binary or CSV workload file
+     * @param sharedMemoryName the POSIX shared memory segment name
+     * @param parseThreadCount number of threads used to parse a CSV file
+     */
+    void loadSharedIntoBuckets(const std::string& filename, const std::string& sharedMemoryName, unsigned int parseThreadCount = 1);
 
-    std::vector<vector_keys_t> getBucket(unsigned int bucketId);
+    /**
+     * Restrict this process to every processCount-th query of the workload,
+     * starting at processIndex. The buckets then divide or replicate that
+     * slice.
+     *
+     * @param processIndex the index of this process, from 0
+     * @param processCount the number of processes sharing the workload
+     */
+    void setProcessSlice(unsigned int processIndex, unsigned int processCount);
+
+    /**
+     * Divide the queries between a different number of runners, for runs
+     * with another thread count. The loaded workload is kept.
+     *
+     * @param bucketCount the number of buckets, at least 1
+     */
+    void setBucketCount(unsigned int bucketCount);
+
+    /**
+     * Return a read-only view of the queries assigned to a bucket.
+     * In divide mode bucket b holds queries b, b + bucketCount, ...
+     * In replicate and dynamic mode every bucket holds all queries, in
+     * dynamic mode the runners share them through a QueryDispatcher.
+     * Both apply to the process slice when one is set.
+     *
+     * @param bucketId the bucket index
+     *
+     * @return the view of the bucket queries
+     */
+    QueryBucket getBucket(unsigned int bucketId);
+
+    OperationMode getMode();
+
+    std::shared_ptr<const QueryWorkload> getWorkload();
 };
 
 class QueryRunner {
 private:
     unsigned int id_;
     std::shared_ptr<RedisDataStore> dataStore_;
-    std::vector<vector_keys_t> queryList_;
+    QueryBucket queryList_;
 
     size_t queryListKeysTotal_ = -1;
     size_t maxKeyLength_ = -1;
 
+    ResultApi resultApi_ = ResultApi::map;
+
+    // Queries kept in flight with the asynchronous fetch API, 0 fetches
+    // one query at a time with the blocking API
+    unsigned int maxInflight_ = 0;
+
+    // Coroutine clients multiplexed on executor_, 0 runs the queries on
+    // the runner thread
+    unsigned int virtualClients_ = 0;
+    std::shared_ptr<CoroutineExecutor> executor_;
+
+    // Shared with the other runners in dynamic mode, null runs the whole bucket
+    std::shared_ptr<QueryDispatcher> dispatcher_;
+
+    // Open-loop arrival rate of this runner, 0 runs closed loop
+    double openLoopRate_ = 0.0;
+    ArrivalDistribution arrivalDistribution_ = ArrivalDistribution::fixed;
+    unsigned int openLoopRunnerIndex_ = 0;
+    unsigned int openLoopRunnerCount_ = 1;
+
+    // Replay the logged query times sped up by this factor, 0 to ignore them
+    double replaySpeedup_ = 0.0;
+
+    // Released by doTestRun once every runner is ready, null starts at once
+    std::shared_ptr<StartGate> startGate_;
+
+    // Cycle through the queries for this long from the start, 0 runs each
+    // query once
+    std::chrono::milliseconds runDuration_ {0};
+    std::chrono::steady_clock::time_point deadline_;
+
+    // Queries of the run, cycling through the bucket, 0 runs each query once
+    size_t queryLimit_ = 0;
+
+    // The cluster client of the data store the runner thread sends through,
+    // runners are spread over the clients by id
+    size_t clusterClient_ = 0;
+
+    // CPUs the runner thread is pinned to, empty leaves it unpinned
+    std::vector<int> cpuAffinity_;
+    // Copy the queries on the runner thread once it is pinned
+    bool localQueries_ = false;
+    // CPUs and NUMA nodes the runner thread ran on in the last run
+    std::vector<int> placementCpus_;
+    std::vector<int> placementNodes_;
+
+    // Query times of the last run, from the intended send time when open loop
+    redis_store::LatencyHistogram queryTimesMicro_;
+    // Guards queryTimesMicro_ while virtual clients record into it
+    std::mutex queryTimesMutex_;
+
+    // Open-loop send times: service time from the actual send and the
+    // delay of each send behind its intended time
+    redis_store::LatencyHistogram serviceTimesMicro_;
+    long long maxSendLagMicro_ = 0;
+
+    // Read by the live interval reporter while the run is in progress, null
+    // when no reporter is running
+    std::shared_ptr<IntervalRecorder> intervalRecorder_;
+
+    void recordInterval(long long latencyMicro, size_t keys, size_t bytes, bool success);
+
     std::string report_;
 
+    redis_store::FetchMetrics fetchMetrics_;
+
+    // Heap allocations made by the run loop, counted in COUNT_ALLOCATIONS builds
+    unsigned long long allocationCount_ = 0;
+
+    // Totals of the last run
+    long runtimeMilliseconds_ = 0;
+    size_t runQueryCount_ = 0;
+    unsigned long querySuccessCount_ = 0;
+    unsigned long fetchedObjectCount_ = 0;
+
     bool runComplete_ = false;
 
     std::string name_;
@@ -53,7 +419,7 @@ private:
 public:
     QueryRunner() = delete;
 
-    QueryRunner(std::string& name, unsigned int id, const std::shared_ptr<RedisDataStore>& dataStore, std::vector<vector_keys_t> queryList);
+    QueryRunner(std::string& name, unsigned int id, const std::shared_ptr<RedisDataStore>& dataStore, QueryBucket queryList);
 
     size_t getMaxKeyLength();
 
@@ -65,23 +431,179 @@ public:
 
     size_t getQueryListKeysTotal();
 
-    void setQueryList(std::vector<vector_keys_t>& queryList);
+    void setQueryList(const QueryBucket& queryList);
+
+    void setResultApi(ResultApi resultApi);
+
+    /**
+     * Fetch with the asynchronous API, keeping up to maxInflight queries
+     * outstanding from the runner thread.
+     *
+     * @param maxInflight the number of outstanding queries, 0 to use the
+     *        blocking API
+     */
+    void setMaxInflight(unsigned int maxInflight);
+
+    /**
+     * Run the queries from virtual clients rather than the runner thread.
+     * Each client is a coroutine sending one query at a time, client c of
+     * n sends queries c, c + n, ... of the bucket, or claims chunks from
+     * the dispatcher when one is set. The clients of all runners share
+     * the executor threads.
+     *
+     * @param virtualClients the number of clients, 0 to run on the runner thread
+     * @param executor the executor the clients run on
+     */
+    void setVirtualClients(unsigned int virtualClients, const std::shared_ptr<CoroutineExecutor>& executor);
+
+    /**
+     * Take queries from a dispatcher shared with the other runners rather
+     * than running the whole bucket. The bucket must be the one the
+     * dispatcher was created for. Virtual clients claim chunks directly.
+     *
+     * @param dispatcher the shared dispatcher, null to run the whole bucket
+     */
+    void setDispatcher(const std::shared_ptr<QueryDispatcher>& dispatcher);
+
+    /**
+     * Send queries open loop at a fixed rate rather than as fast as the
+     * previous query completes. Query latency is then measured from the
+     * intended send time, so time spent behind schedule is counted.
+     *
+     * @param ratePerSecond the arrival rate of this runner
+     * @param distribution the distribution of the gaps between arrivals
+     * @param runnerIndex the place of this runner among the runners of
+     *        every process, which seeds Poisson arrivals and offsets fixed
+     *        ones
+     * @param runnerCount the number of runners of every process
+     */
+    void setOpenLoop(double ratePerSecond, ArrivalDistribution distribution, unsigned int runnerIndex, unsigned int runnerCount);
+
+    /**
+     * Send each query open loop at the time it was sent in the original
+     * log, relative to the first query of the workload and divided by the
+     * speedup. Replaces the open-loop arrival schedule. The workload must
+     * have query times.
+     *
+     * @param speedup 1 for the logged pace, 2 for twice as fast, 0 to
+     *        ignore the query times
+     */
+    void setReplay(double speedup);
+
+    /**
+     * Wait at the gate before starting the run, so the runners of a test
+     * start together. The runtime is measured from the release.
+     *
+     * @param startGate the gate shared by the runners, null to start at once
+     */
+    void setStartGate(const std::shared_ptr<StartGate>& startGate);
+
+    /**
+     * Run for a fixed time rather than through the queries once: the
+     * runner, or each of its virtual clients, starts again from its first
+     * query at the end of its queries until the duration has passed since
+     * the start. Queries in flight at the deadline still complete.
+     *
+     * @param duration the run time, 0 to run every query once
+     */
+    void setDuration(std::chrono::milliseconds duration);
+
+    /**
+     * Run a fixed number of queries rather than through the queries once,
+     * cycling through the queries as setDuration does. The limit is split
+     * evenly between the virtual clients.
+     *
+     * @param queryLimit the queries of the run, 0 to run every query once
+     */
+    void setQueryLimit(size_t queryLimit);
+
+    /**
+     * Pin the runner thread to CPUs for the run. Its latency histograms are
+     * then allocated on the runner thread, so they are placed on the NUMA
+     * node of its CPUs.
+     *
+     * @param cpus the CPUs, empty to leave the thread unpinned
+     * @param localQueries also copy the runner's queries on the runner
+     *        thread, rather than reading them from the shared workload
+     */
+    void setCpuAffinity(const std::vector<int>& cpus, bool localQueries);
+
+    /**
+     * Record every completed query in the recorder as well, for an
+     * IntervalReporter to read while the run is in progress.
+     *
+     * @param intervalRecorder the recorder of this runner, null for none
+     */
+    void setIntervalRecorder(const std::shared_ptr<IntervalRecorder>& intervalRecorder);
+
+    /**
+     * Fetch the keys of one query with the configured result API.
+     *
+     * @param fetchedBytes set to the total size of the values fetched
+     * @return the number of objects fetched
+     */
+    size_t fetchQuery(const redis_store::vector_hashslot_keys_t& queryKeys, redis_store::vector_results_t& resultObjects, size_t& fetchedBytes);
 
     bool readyToRun();
 
+    /**
+     * Counters of one virtual client, merged into the runner report.
+     */
+    struct VirtualClientState {
+        size_t queryCount = 0;
+        unsigned long successCount = 0;
+        unsigned long fetchedObjectCount = 0;
+    };
+
+    VirtualClientTask virtualClient(size_t clientId, QueryCursor cursor, VirtualClientState& state);
+
+    /**
+     * Create the cursor over the queries of this runner, or of one of its
+     * virtual clients.
+     *
+     * @param first the first query of a fixed stride, and the index of
+     *        the virtual client the query limit is split for
+     * @param stride the fixed stride, ignored with a dispatcher, and the
+     *        number of virtual clients
+     */
+    QueryCursor makeCursor(size_t first, size_t stride);
+
+    /**
+     * Run the bucket on the virtual clients and wait for them to finish.
+     *
+     * @return the merged client counters
+     */
+    VirtualClientState runVirtualClients();
+
     void run();
 
     bool runComplete();
 
     boost::thread spawn();
 
-    void makeReport(long runtime,
-                    size_t queryCount,
-                    unsigned long querySuccessCount,
-                    unsigned long totalFetchedObjects,
-                    std::vector<long long> individualQueryTimes);
+    void makeReport(long runtime, size_t queryCount, unsigned long querySuccessCount, unsigned long totalFetchedObjects);
 
     std::string getReport();
+
+    /**
+     * Return the results of the last run as JSON: the query counts,
+     * runtime and query time histograms, for the machine readable results.
+     *
+     * @return the JSON object
+     */
+    Json::Value getResultJson();
+
+    const redis_store::FetchMetrics& getFetchMetrics();
+
+    /**
+     * @return the query times of the last run, in microseconds
+     */
+    const redis_store::LatencyHistogram& getQueryTimes();
+
+    /**
+     * @return the open-loop service times of the last run, in microseconds
+     */
+    const redis_store::LatencyHistogram& getServiceTimes();
 };
 
 }  // namespace query_runner
\ No newline at end of file
@@ -0,0 +1,390 @@
+/**
+ * @file redis_workload/query_workload.h
+ *
+ * @brief Immutable, shared representation of a parsed query log
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * Identifier of an interned key in a QueryWorkload.
+ */
+typedef uint32_t key_id_t;
+
+/**
+ * The keys of a single query, as identifiers into the workload key arena.
+ */
+typedef std::span<const key_id_t> query_key_ids_t;
+
+/**
+ * Header of the binary workload format.
+ *
+ * The header is followed by the workload sections, each starting at the
+ * recorded byte offset from the start of the file and aligned to 8 bytes:
+ *     keyOffsets     uint64_t[keyCount + 1]
+ *     queryOffsets   uint64_t[queryCount + 1]
+ *     queryKeyIds    uint32_t[queryKeysTotal]
+ *     keyHashslots   uint16_t[keyCount]
+ *     queryTimes     int64_t[queryCount], only when queryTimesPos is not 0
+ *     keyArena       char[keyArenaSize]
+ * All values are stored in host byte order.
+ */
+struct WorkloadFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint64_t keyCount;
+    uint64_t queryCount;
+    uint64_t queryKeysTotal;
+    uint64_t keyArenaSize;
+    uint64_t keyOffsetsPos;
+    uint64_t queryOffsetsPos;
+    uint64_t queryKeyIdsPos;
+    uint64_t keyHashslotsPos;
+    uint64_t queryTimesPos;
+    uint64_t keyArenaPos;
+};
+
+inline static const char kWorkloadFileMagic[8] = {'R', 'W', 'L', 'B', 'I', 'N', '\0', '\0'};
+inline static const uint32_t kWorkloadFileVersion = 2;
+
+/**
+ * The data file a workload was loaded from and how it was parsed. A
+ * workload published in shared memory records its source, so a process
+ * attaching to the segment can check it holds the workload it was asked
+ * to run.
+ */
+struct WorkloadSource {
+    // Absolute path of the data file
+    std::string path;
+    uint64_t size = 0;
+    // Modification time, nanoseconds since the epoch
+    int64_t mtimeNanos = 0;
+    // The first CSV column was read as the query time (-T)
+    bool csvQueryTimes = false;
+
+    /**
+     * Describe a data file as it is now.
+     *
+     * @param filename the data file
+     * @param csvQueryTimes true if the first CSV column is the query time
+     *
+     * @throws std::runtime_error if the file cannot be read.
+     */
+    static WorkloadSource fromFile(const std::string& filename, bool csvQueryTimes);
+
+    [[nodiscard]] bool operator==(const WorkloadSource& other) const = default;
+
+    [[nodiscard]] std::string toString() const;
+};
+
+/**
+ * A query log stored once per process.
+ *
+ * Every distinct key is stored a single time in a contiguous arena, along
+ * with its precomputed Redis hashslot, and each query is a range of 32-bit
+ * key identifiers. The workload is not modified after it is built, so
+ * runners share it through read-only views without copying any queries.
+ *
+ * The workload data is either owned by the workload, when built from a CSV
+ * file, or read in place from a memory mapped binary workload file.
+ */
+class QueryWorkload {
+private:
+    friend class QueryWorkloadBuilder;
+    friend class QueryBucket;
+
+    // Owned storage, empty when the workload is backed by a binary image
+    std::string keyArena_;
+    std::vector<uint64_t> keyOffsets_ {0};
+    std::vector<uint64_t> queryOffsets_ {0};
+    std::vector<key_id_t> queryKeyIds_;
+    std::vector<uint16_t> keyHashslots_;
+    std::vector<int64_t> queryTimes_;
+
+    // Keeps a binary image alive for the lifetime of the workload
+    std::shared_ptr<const void> image_;
+
+    const char* keyArenaData_ = nullptr;
+    const uint64_t* keyOffsetsData_ = nullptr;
+    const uint64_t* queryOffsetsData_ = nullptr;
+    const key_id_t* queryKeyIdsData_ = nullptr;
+    const uint16_t* keyHashslotsData_ = nullptr;
+    const int64_t* queryTimesData_ = nullptr;
+    int64_t firstQueryTime_ = 0;
+    size_t keyCount_ = 0;
+    size_t queryCount_ = 0;
+    size_t queryKeysTotal_ = 0;
+    size_t keyArenaSize_ = 0;
+
+    void pointAtOwnedStorage();
+
+    void findFirstQueryTime();
+
+public:
+    QueryWorkload();
+
+    QueryWorkload(const QueryWorkload&) = delete;
+    QueryWorkload& operator=(const QueryWorkload&) = delete;
+
+    [[nodiscard]] size_t getKeyCount() const {
+        return keyCount_;
+    }
+
+    [[nodiscard]] std::string_view getKey(key_id_t id) const {
+        return {keyArenaData_ + keyOffsetsData_[id], keyOffsetsData_[id + 1] - keyOffsetsData_[id]};
+    }
+
+    [[nodiscard]] uint16_t getHashslot(key_id_t id) const {
+        return keyHashslotsData_[id];
+    }
+
+    [[nodiscard]] size_t getQueryCount() const {
+        return queryCount_;
+    }
+
+    [[nodiscard]] query_key_ids_t getQuery(size_t index) const {
+        return {queryKeyIdsData_ + queryOffsetsData_[index], queryOffsetsData_[index + 1] - queryOffsetsData_[index]};
+    }
+
+    [[nodiscard]] size_t getQueryKeysTotal() const {
+        return queryKeysTotal_;
+    }
+
+    /**
+     * @return true if the workload records when each query was sent.
+     */
+    [[nodiscard]] bool hasQueryTimes() const {
+        return queryTimesData_ != nullptr;
+    }
+
+    /**
+     * Return the time a query was sent in the original log, only valid
+     * when hasQueryTimes() is true.
+     *
+     * @param index the query index
+     * @return microseconds since the epoch of the log timestamps
+     */
+    [[nodiscard]] int64_t getQueryTime(size_t index) const {
+        return queryTimesData_[index];
+    }
+
+    /**
+     * @return the earliest query time of the workload, 0 without query times
+     */
+    [[nodiscard]] int64_t getFirstQueryTime() const {
+        return firstQueryTime_;
+    }
+
+    /**
+     * Return the memory used by the workload data.
+     *
+     * @return the size in bytes
+     */
+    [[nodiscard]] size_t getMemoryUsage() const;
+
+    /**
+     * Return the size of the binary image of this workload.
+     *
+     * @return the size in bytes
+     */
+    [[nodiscard]] size_t getBinaryImageSize() const;
+
+    /**
+     * Serialize the workload in the binary workload format.
+     *
+     * @param dest destination buffer of at least getBinaryImageSize() bytes
+     */
+    void writeBinaryImage(char* dest) const;
+
+    /**
+     * Write the workload to a binary workload file.
+     *
+     * @param filename the file to create or replace
+     *
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void writeBinaryFile(const std::string& filename) const;
+
+    /**
+     * Create a workload that reads its data in place from a binary image.
+     *
+     * @param image owner of the image memory, kept alive by the workload
+     * @param data start of the image
+     * @param size size of the image in bytes
+     *
+     * @throws std::runtime_error if the image is not a valid binary workload.
+     */
+    static std::shared_ptr<const QueryWorkload> fromBinaryImage(std::shared_ptr<const void> image, const char* data, size_t size);
+
+    /**
+     * Memory map a binary workload file and use it in place.
+     *
+     * @param filename the binary workload file
+     *
+     * @throws std::runtime_error if the file cannot be mapped or is invalid.
+     */
+    static std::shared_ptr<const QueryWorkload> loadBinaryFile(const std::string& filename);
+
+    /**
+     * Use the workload held in a named POSIX shared memory segment.
+     *
+     * If the segment does not exist, the calling process creates it, calls
+     * loader and publishes the binary image of the loaded workload in the
+     * segment. Processes that find an existing segment wait until the image
+     * is published and then map it read-only, so all processes share a
+     * single copy of the workload. The segment outlives the processes and
+     * must be removed with shm_unlink, or from /dev/shm, when no longer used.
+     *
+     * The segment records the source of the workload ahead of the image. A
+     * process attaching to a segment published from another source, for
+     * example one left behind by an earlier run with a different data file,
+     * fails rather than running that workload.
+     *
+     * @param name the shared memory segment name, for example "/redis_workload"
+     * @param source the data file the workload is loaded from
+     * @param loader loads the workload when this process creates the segment
+     * @param timeout how long to wait for another process to publish the image
+     *
+     * @throws std::runtime_error if the segment cannot be created or attached,
+     *         or holds the workload of another source.
+     */
+    static std::shared_ptr<const QueryWorkload> openSharedMemory(const std::string& name,
+                                                                 const WorkloadSource& source,
+                                                                 const std::function<std::shared_ptr<const QueryWorkload>()>& loader,
+                                                                 std::chrono::seconds timeout = std::chrono::seconds(600));
+
+    /**
+     * Check for the binary workload file magic at the start of the file.
+     *
+     * @param filename the file to check
+     *
+     * @return true if the file holds a binary workload.
+     */
+    static bool isBinaryFile(const std::string& filename);
+};
+
+/**
+ * Incrementally build a QueryWorkload, interning keys as they are added.
+ *
+ * Keys passed to the builder are only referenced, not copied, until
+ * build() is called, so the storage behind them must outlive the builder.
+ */
+class QueryWorkloadBuilder {
+private:
+    std::unordered_map<std::string_view, key_id_t> keyIds_;
+    std::vector<std::string_view> keys_;
+    std::shared_ptr<QueryWorkload> workload_;
+
+    key_id_t internKey(std::string_view key);
+
+    void appendQuery(std::span<const std::string_view> keys);
+
+public:
+    QueryWorkloadBuilder();
+
+    /**
+     * Append a query to the workload.
+     *
+     * @param keys the keys of the query
+     */
+    void addQuery(std::span<const std::string_view> keys);
+
+    /**
+     * Append a query along with the time it was sent. Either every query
+     * of a workload has a time or none does.
+     *
+     * @param keys the keys of the query
+     * @param queryTime microseconds since the epoch of the log timestamps
+     *
+     * @throws std::logic_error if earlier queries were added without a time.
+     */
+    void addQuery(std::span<const std::string_view> keys, int64_t queryTime);
+
+    /**
+     * Copy the interned keys into the workload arena, calculate the
+     * hashslot of every key and return the finished workload. The
+     * builder must not be used afterwards.
+     *
+     * @return the immutable workload
+     */
+    std::shared_ptr<const QueryWorkload> build();
+};
+
+/**
+ * Read-only view of the queries assigned to a single runner.
+ *
+ * The view selects every stride-th query of the shared workload starting at
+ * first, so dividing or replicating a workload across runners does not
+ * copy any query data.
+ */
+class QueryBucket {
+private:
+    std::shared_ptr<const QueryWorkload> workload_;
+    size_t first_ = 0;
+    size_t stride_ = 1;
+    size_t count_ = 0;
+
+public:
+    QueryBucket() = default;
+
+    QueryBucket(std::shared_ptr<const QueryWorkload> workload, size_t first, size_t stride);
+
+    [[nodiscard]] size_t size() const {
+        return count_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return count_ == 0;
+    }
+
+    [[nodiscard]] query_key_ids_t getQuery(size_t index) const {
+        return workload_->getQuery(first_ + (index * stride_));
+    }
+
+    [[nodiscard]] std::string_view getKey(key_id_t id) const {
+        return workload_->getKey(id);
+    }
+
+    [[nodiscard]] uint16_t getHashslot(key_id_t id) const {
+        return workload_->getHashslot(id);
+    }
+
+    [[nodiscard]] bool hasQueryTimes() const {
+        return workload_->hasQueryTimes();
+    }
+
+    [[nodiscard]] int64_t getQueryTime(size_t index) const {
+        return workload_->getQueryTime(first_ + (index * stride_));
+    }
+
+    [[nodiscard]] int64_t getFirstQueryTime() const {
+        return workload_->getFirstQueryTime();
+    }
+
+    /**
+     * Copy the queries of the view, with their keys, into a workload of
+     * their own, allocated and first written by the calling thread so the
+     * copy is placed on the calling thread's NUMA node. The copy keeps the
+     * first query time of the whole workload, so replay offsets do not
+     * change.
+     *
+     * @return a view of every query of the copy, in the same order
+     */
+    [[nodiscard]] QueryBucket copyQueries() const;
+};
+
+}  // namespace query_runner
@@ -1,20 +1,29 @@
 #pragma once
+#include <redis_workload/cluster_topology.h>
 #include <redis_workload/datatypes.h>
 #include <redis_workload/redis_store_params.h>
+#include <redis_workload/util.h>
 #include <sw/redis++/async_redis++.h>
 #include <sw/redis++/async_redis.h>
 #include <sw/redis++/async_redis_cluster.h>
 
 #include <algorithm>
+#include <atomic>
 #include <boost/functional/hash.hpp>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_set>
+#include <vector>
 
 using redis_store::vector_keys_t;
 
 namespace redis_store {
 
+struct async_fetch_t;
+
 /**
  * Low-level handling of data store communication with Redis Cluster.
  *
@@ -28,14 +37,47 @@ namespace redis_store {
 class RedisDataStore {
 private:
     static std::shared_ptr<RedisDataStore> redisDataStore_;
+    static std::atomic<uint64_t> nextGeneration_;
     RedisStoreParams params_;
+    // Unique to this store within the process, from 1. Per-thread caches
+    // are keyed on it rather than the address, which a later store may reuse.
+    const uint64_t generation_;
 
     int maxMultiKeyBatchCount_ = 0;
     std::string redisKeyPrefix_;
     std::string redisKeySuffix_;
     std::string datasetMetaDataKey;
 
-    std::unique_ptr<sw::redis::AsyncRedisCluster> redisConnection_;
+    // Independent cluster clients, each with its own event loop thread and
+    // connection pool. Every thread sends through one of them.
+    std::vector<std::unique_ptr<sw::redis::AsyncRedisCluster>> redisConnections_;
+    // The CPUs each client's event loop thread is pinned to, empty if unpinned
+    std::vector<std::vector<int>> redisConnectionCpus_;
+    std::atomic<size_t> nextThreadClient_ = 0;
+
+    bool batchByNode_ = false;
+    bool timeFetchStages_ = false;
+
+    // Current hashslot ownership. Readers cache the pointer per thread and
+    // reload it when topologyEpoch_ changes.
+    std::mutex topologyMutex_;
+    std::shared_ptr<const ClusterTopology> topology_;
+    std::atomic<uint64_t> topologyEpoch_ = 0;
+    // Set by asynchronous replies redirected by a node, cleared by the
+    // next request that refreshes the topology
+    std::atomic<bool> topologyStale_ = false;
+
+    /**
+     * Return the cluster client of the calling thread, assigning threads
+     * to the clients in turn on first use unless bound with
+     * bindThreadToClient.
+     */
+    sw::redis::AsyncRedisCluster& getThreadClient();
+
+    /**
+     * Return the index of the cluster client of the calling thread.
+     */
+    size_t getThreadClientIndex();
 
     // /**
     //  * Establish network connections to all Redis shards.
@@ -67,13 +109,15 @@ private:
      * Precondition: keys and dataObjects are assumed to be in corresponding
      * order.
      *
-     * @param keys a vector of the Redis key strings
-     * @param dataObjects vector of data results from Redis
+     * @param keys the Redis keys of one MGET slice
+     * @param dataObjects vector of data results from Redis, moved into zippedData
      * @param zippedData unordered_map of key:dataObject values
+     * @param indexByHashtag boolean indicating whether zippedData is indexed by key or hashtag value
      */
-    void zipResultObjects(const std::shared_ptr<vector_keys_t>& keys,
-                          const std::shared_ptr<vector_results_t>& dataObjects,
-                          const std::shared_ptr<multiget_result_map_t>& zippedData);
+    void zipResultObjects(std::span<const std::string_view> keys,
+                          vector_results_t& dataObjects,
+                          multiget_result_map_t& zippedData,
+                          bool indexByHashtag);
 
     /**
      * Perform GET operation against a Redis Cluster for the given key.
@@ -83,9 +127,114 @@ private:
      */
     void redisGet(const std::string& key, std::string* result);
 
-    void crossslotRedisMget(vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+    void crossslotRedisMget(const HashslotKeyGroups& hashslotGroups, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+
+    /**
+     * Perform MGET operations for the grouped keys and store the results in
+     * the order of the keys originally grouped.
+     *
+     * @param hashslotGroups Redis keys grouped by the hashslot they hash to.
+     * @param results the fetched objects, one per grouped input key.
+     */
+    void crossslotRedisMget(const HashslotKeyGroups& hashslotGroups, vector_results_t& results);
+
+    /**
+     * Issue the MGET operations for all hashslot groups.
+     *
+     * @param hashslotGroups Redis keys grouped by the hashslot they hash to.
+     * @return the pending MGET slices, owned by the calling thread and
+     *         reused by its next call.
+     */
+    mget_future_slices_t& issueCrossslotRedisMget(const HashslotKeyGroups& hashslotGroups);
+
+    /**
+     * Issue MGETs for keys that hash to a single Redis hashslot, appending
+     * one slice per MGET. Keys beyond maxMultiKeyBatchSize are split into
+     * the fewest slices within the limit, with balanced sizes. The MGETs
+     * are sent through the cluster client, or through nodeConnection when
+     * given.
+     *
+     * @param keys Redis keys that hash to a single Redis hashslot.
+     * @param slices the pending MGET slices.
+     * @param nodeConnection connection to the node owning the hashslot, or nullptr.
+     */
+    void redisMget(std::span<const std::string_view> keys, mget_future_slices_t& slices, sw::redis::AsyncRedis* nodeConnection = nullptr);
 
-    void redisMget(vector_keys_t& keys, const std::shared_ptr<mgetFutureResultMap>& results);
+    /**
+     * Issue the MGETs for all hashslot groups ordered by owning node, so the
+     * MGETs for each node are pipelined on that node's connection.
+     *
+     * @param hashslotGroups Redis keys grouped by the hashslot they hash to.
+     * @param slices the pending MGET slices.
+     * @return the number of round trips: one per node, plus one per slice
+     *         sent through the cluster client for unassigned slots
+     */
+    size_t nodeBatchedRedisMget(const HashslotKeyGroups& hashslotGroups, mget_future_slices_t& slices);
+
+    /**
+     * Call issueGroup(keys, nodeConnection) for every hashslot group,
+     * ordered by owning node. nodeConnection is nullptr for groups whose
+     * slot has no known owner. issueGroup returns the number of MGETs it
+     * issued.
+     *
+     * @param hashslotGroups Redis keys grouped by the hashslot they hash to.
+     * @param issueGroup issues the MGETs of one group.
+     * @return the number of round trips
+     */
+    template <typename IssueGroup>
+    size_t forEachNodeGroup(const HashslotKeyGroups& hashslotGroups, IssueGroup&& issueGroup);
+
+    /**
+     * Return the number of MGETs a group of keysCount keys is split into.
+     */
+    [[nodiscard]] size_t getBatchSliceCount(size_t keysCount) const;
+
+    /**
+     * Issue one MGET slice of an asynchronous fetch, storing its results
+     * in the fetch state from the reply callback.
+     *
+     * @param fetch the fetch state
+     * @param sliceKeys the keys of the slice, hashing to one hashslot
+     * @param nodeConnection connection to the node owning the hashslot, or nullptr.
+     */
+    void asyncRedisMget(const std::shared_ptr<async_fetch_t>& fetch, std::span<const std::string_view> sliceKeys, sw::redis::AsyncRedis* nodeConnection);
+
+    /**
+     * Wait for the result of an MGET slice. A MOVED or ASK reply to an MGET
+     * sent directly to a node refreshes the topology and retries the slice
+     * through the cluster client, which follows the redirection.
+     *
+     * @param slice the pending MGET slice
+     * @return the MGET results in key order
+     */
+    vector_results_t getSliceResults(mget_future_slice_t& slice);
+
+    /**
+     * Read the current slot to node map from the cluster.
+     *
+     * @throws sw::redis::Error or std::runtime_error when the map cannot be read.
+     *
+     * @return the cluster topology
+     */
+    std::shared_ptr<const ClusterTopology> getClusterSlots();
+
+    /**
+     * Replace the cached topology, unless it was already replaced since the
+     * caller read observedEpoch. Failures are reported and the previous
+     * topology is kept.
+     *
+     * @param observedEpoch the topology epoch the caller found stale
+     */
+    void refreshClusterTopology(uint64_t observedEpoch);
+
+    /**
+     * Warn when a fetch returned a different number of objects than the
+     * number of distinct keys requested.
+     *
+     * @param keysCount the number of distinct keys requested
+     * @param results the fetched objects
+     */
+    static void checkFetchResultCount(size_t keysCount, const std::shared_ptr<multiget_result_map_t>& results);
 
     /**
      * Perform the Redis Cluster command that returns a string synchronously.
@@ -112,17 +261,6 @@ private:
      */
     std::string issueSynchronousRedisStringCommand(const std::initializer_list<const char*>& command, std::string hashtag = "0");
 
-    /**
-     * Perform the Redis command that returns an array synchronously.
-     *
-     * The command provided must produce an Array result.
-     *
-     * @param command the requested command stored in a vector. For example, the redis-cli command "CLUSTER INFO" should be
-     *                represented as {"CLUSTER", "SLOTS"}
-     * @return the result returned from the Redis cluster
-     */
-//    [[maybe_unused]] void issueSynchronousRedisArrayCommand(const std::initializer_list<const char*>& command);
-
 public:
     /**
      * Construct an RedisDataStore instance using the supplied.
@@ -149,6 +287,64 @@ public:
      */
     static std::shared_ptr<RedisDataStore> factory();
 
+    /**
+     * Static factory method to instantiate the RedisDataStore singleton
+     * using the supplied parameters.
+     *
+     * @param params the configuration parameters for the Redis Data Store
+     *
+     * @return the RedisDataStore instance.
+     */
+    static std::shared_ptr<RedisDataStore> factory(const RedisStoreParams& params);
+
+    /**
+     * Drop the singleton, so the next factory call connects with new
+     * parameters. The store is destroyed once its last user releases it.
+     */
+    static void release();
+
+    /**
+     * Return the parameters used by factory(), with the Redis host and
+     * credentials taken from the environment.
+     *
+     * @param requireEnvironment exit with an error if REDIS_HOST,
+     *        REDIS_PORT, REDIS_USER or REDIS_PASS is not set, otherwise
+     *        leave the fields of unset variables empty
+     * @return the default configuration parameters
+     * @throws ConfigParamError if REDIS_PORT is not a number.
+     */
+    static RedisStoreParams getDefaultParams(bool requireEnvironment = true);
+
+    /**
+     * Send the requests of the calling thread through one cluster client,
+     * so threads can be spread evenly over the clients.
+     *
+     * @param clientIndex the client, taken modulo the client count
+     */
+    void bindThreadToClient(size_t clientIndex);
+
+    /**
+     * @return the number of independent cluster clients
+     */
+    [[nodiscard]] size_t getClientCount() const {
+        return redisConnections_.size();
+    }
+
+    /**
+     * @return the CPUs the event loop thread of each client is pinned to,
+     *         empty for an unpinned client
+     */
+    [[nodiscard]] const std::vector<std::vector<int>>& getClientCpus() const {
+        return redisConnectionCpus_;
+    }
+
+    /**
+     * Return the cached slot to node map of the cluster.
+     *
+     * @return the topology, nullptr when node batching is disabled
+     */
+    std::shared_ptr<const ClusterTopology> getClusterTopology();
+
     /**
      * Retrieve the features identified by Redis key values from the
      * Data Store.
@@ -160,7 +356,67 @@ public:
      * @param result an empty collection used to hold the retrieved features.
      * @param indexByHashtag boolean indicating whether the result map should be index by key value or hashtag value.
      */
-    void fetchByFeatureKeys(vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+    void fetchByFeatureKeys(const vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+
+    /**
+     * Retrieve the features identified by Redis key values from the
+     * Data Store, without copying the keys.
+     *
+     * Duplicate keys are fetched once. The storage referenced by the views
+     * must remain valid until the call returns.
+     *
+     * @param keys a vector of views of the requested Redis keys.
+     * @param result an empty collection used to hold the retrieved features.
+     * @param indexByHashtag boolean indicating whether the result map should be index by key value or hashtag value.
+     */
+    void fetchByFeatureKeys(const vector_key_views_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+
+    /**
+     * Retrieve the features identified by Redis keys whose hashslots have
+     * already been calculated, for example by the workload loader. This
+     * keeps CRC16 calculation out of the request path.
+     *
+     * @param keys the requested Redis keys and their hashslots.
+     * @param result an empty collection used to hold the retrieved features.
+     * @param indexByHashtag boolean indicating whether the result map should be index by key value or hashtag value.
+     */
+    void fetchByFeatureKeys(const vector_hashslot_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag = false);
+
+    /**
+     * Retrieve the features identified by Redis key values into a vector
+     * aligned with the keys: results[i] holds the object for keys[i], or
+     * no value when the key does not exist. Duplicate keys are fetched once
+     * and their object is copied to every position. No key is copied.
+     *
+     * @param keys a vector of views of the requested Redis keys.
+     * @param results resized to keys.size() and filled with the retrieved features.
+     */
+    void fetchByFeatureKeys(const vector_key_views_t& keys, vector_results_t& results);
+
+    /**
+     * Retrieve the features identified by Redis keys whose hashslots have
+     * already been calculated into a vector aligned with the keys.
+     *
+     * @param keys the requested Redis keys and their hashslots.
+     * @param results resized to keys.size() and filled with the retrieved features.
+     */
+    void fetchByFeatureKeys(const vector_hashslot_keys_t& keys, vector_results_t& results);
+
+    /**
+     * Start retrieving the features identified by Redis keys whose
+     * hashslots have already been calculated, without waiting for them.
+     *
+     * All MGETs of the request are issued before returning. callback runs
+     * once, on a redis++ event loop thread, after the last MGET completes,
+     * with results aligned with keys as for the vector fetchByFeatureKeys.
+     * It must not block. The keys vector may be reused once the call
+     * returns, the storage referenced by the views must remain valid until
+     * the callback runs.
+     *
+     * @param keys the requested Redis keys and their hashslots.
+     * @param callback called with the results and any error.
+     */
+    void fetchByFeatureKeysAsync(const vector_hashslot_keys_t& keys, fetch_callback_t callback);
 
     /**
      * Return the configured maximum number of keys
@@ -207,11 +463,6 @@ public:
      * @return the metadata string.
      */
     std::string getDatasetMeta();
-
-    /**
-     *
-     */
-//    void getClusterSlots();
 };
 
 }  // namespace redis_store
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <json/json.h>
+
 #include <string>
+#include <vector>
 
 namespace redis_store {
 
 class RedisStoreParams {
 private:
-    const int Min_Port_Number_ = 1024;
+    static constexpr int Min_Port_Number_ = 1024;
 
 public:
     std::string redisHost;
@@ -17,10 +20,25 @@ public:
     std::string redisKeySuffix;
     bool preferReadReplicas = true;
     int poolSize = 3;
+    // Milliseconds
     int poolWaitTimeout = 0;
+    // Minutes
     int poolConnectionLifetime = 10;
+    // Milliseconds
     int poolConnectionMaxIdle = 0;
     int maxMultiKeyBatchSize = 10;
+    // Send the per-hashslot MGETs of a request to each owning node together,
+    // pipelined on one connection per node
+    bool batchByNode = false;
+    // Split the time of blocking fetches into stages in the FetchMetrics
+    bool timeFetchStages = false;
+    // Independent cluster clients, each with its own event loop thread and
+    // connection pool, the threads of the process are spread over them
+    int clusterClients = 1;
+    // Placement of the event loop threads, a CPU list for one CPU per client
+    // in turn or "node:" and NUMA nodes for one node per client, empty to
+    // leave them unpinned
+    std::string clusterClientCpus;
 
     /**
      * Validate the RedisStoreParam field values.
@@ -31,6 +49,37 @@ public:
      */
     // TODO: Add validation checks for all config values
     bool valid() const;
+
+    /**
+     * Set a field from its name in the config file, as listed by
+     * getFieldNames(), for example "pool_size".
+     *
+     * @param name the config name of the field
+     * @param value the value, "true" or "false" for flags
+     * @throws ConfigParamError for an unknown name or a bad value.
+     */
+    void set(const std::string& name, const std::string& value);
+
+    /**
+     * Set the fields present in a JSON config file, an object of config
+     * names and values. The "store" object of a results file is accepted.
+     *
+     * @param filename the config file
+     * @throws ConfigParamError if the file cannot be read or a field is bad.
+     */
+    void loadConfigFile(const std::string& filename);
+
+    /**
+     * Return the fields by config name, without the password.
+     *
+     * @return the JSON object
+     */
+    [[nodiscard]] Json::Value toJson() const;
+
+    /**
+     * Return the config names of all fields.
+     */
+    static const std::vector<std::string>& getFieldNames();
 };
 
 inline static const std::string kConfigRedisClusterHost = "redis_cluster_address";
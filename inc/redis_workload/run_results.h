@@ -0,0 +1,124 @@
+/**
+ * @file redis_workload/run_results.h
+ *
+ * @brief Combined results of one test run across processes
+ */
+#pragma once
+
+#include <json/json.h>
+#include <redis_workload/latency_histogram.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * Combines the JSON results of the same test run from several processes,
+ * as written by run_redis_workload -J or returned by its worker processes.
+ * The latency histograms are merged, so the percentiles are those of all
+ * the queries rather than an average of per-process percentiles.
+ */
+class RunResults {
+private:
+    std::string name_;
+    size_t resultCount_ = 0;
+    unsigned long long queries_ = 0;
+    unsigned long long successes_ = 0;
+    // The processes of a test run concurrently, so their rates add up
+    double queriesPerSecond_ = 0.0;
+    long long maxRuntimeMilliseconds_ = 0;
+    redis_store::LatencyHistogram queryTimes_;
+    redis_store::LatencyHistogram serviceTimes_;
+
+public:
+    RunResults() = default;
+
+    explicit RunResults(const std::string& name);
+
+    /**
+     * Add the results of the run from one more process.
+     *
+     * @param runResult the JSON results of the run
+     * @throws std::runtime_error if a serialized histogram is invalid.
+     */
+    void add(const Json::Value& runResult);
+
+    [[nodiscard]] const std::string& getName() const {
+        return name_;
+    }
+
+    [[nodiscard]] size_t getResultCount() const {
+        return resultCount_;
+    }
+
+    [[nodiscard]] unsigned long long getQueries() const {
+        return queries_;
+    }
+
+    [[nodiscard]] unsigned long long getSuccesses() const {
+        return successes_;
+    }
+
+    [[nodiscard]] double getQueriesPerSecond() const {
+        return queriesPerSecond_;
+    }
+
+    [[nodiscard]] const redis_store::LatencyHistogram& getQueryTimes() const {
+        return queryTimes_;
+    }
+
+    [[nodiscard]] const redis_store::LatencyHistogram& getServiceTimes() const {
+        return serviceTimes_;
+    }
+
+    /**
+     * Format the combined counts, throughput and percentiles.
+     *
+     * @param label prefix of every line, for example "count4 threads-1.json run2"
+     * @return the report text
+     */
+    [[nodiscard]] std::string toString(const std::string& label) const;
+
+    /**
+     * Return the combined results in the layout of a single run's results,
+     * with the number of results combined, so they can be combined again.
+     *
+     * @return the JSON object
+     */
+    [[nodiscard]] Json::Value toJson() const;
+};
+
+/**
+ * Spread of one metric over the measured iterations of a test.
+ */
+struct iteration_summary_t {
+    size_t count = 0;
+    double mean = 0.0;
+    // Sample standard deviation, 0 for a single iteration
+    double stddev = 0.0;
+    // Half width of the 95% confidence interval of the mean, from the
+    // Student t distribution, 0 for a single iteration
+    double confidence95 = 0.0;
+};
+
+/**
+ * Summarize the values of a metric, one per iteration.
+ *
+ * @param values the value of each iteration
+ * @return the mean, standard deviation and confidence interval
+ */
+iteration_summary_t summarizeIterations(const std::vector<double>& values);
+
+/**
+ * Format a summary as "mean X, stddev Y (Z%), 95% CI +/- W (low to high)".
+ *
+ * @param summary the summary of the metric
+ * @param unit the unit of the metric, for example "queries/s"
+ */
+std::string iterationSummaryToString(const iteration_summary_t& summary, const std::string& unit);
+
+Json::Value iterationSummaryToJson(const iteration_summary_t& summary);
+
+}  // namespace query_runner
@@ -5,7 +5,9 @@
 #include <boost/crc.hpp>      // for boost::crc_basic, boost::crc_optimal
 #include <boost/cstdint.hpp>  // for boost::uint16_t
 #include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace redis_store {
@@ -15,17 +17,109 @@ inline std::string bool_to_string(bool value) {
     return (value ? "T" : "F");
 }
 
+/**
+ * @return the value of an environment variable, empty if it is not set
+ */
+std::string getEnvVar(const std::string& key);
+
 std::pair<std::string, std::string> getRedisCredentialsFromEnv();
 
 std::pair<std::string, int> getRedisHostFromEnv();
 
+/**
+ * Distinct keys of a request grouped by Redis hashslot.
+ *
+ * Keys are sorted by hashslot, deduplicated and stored contiguously, and
+ * each group is a span over its run of keys. The position of every input
+ * key is mapped to the index of its distinct key, so results fetched for
+ * the distinct keys can be placed back in input order. The internal
+ * vectors keep their capacity between requests, so a long lived instance
+ * groups keys without allocating once it has seen the largest request.
+ */
+class HashslotKeyGroups {
+private:
+    struct positioned_key_t {
+        hashslot_key_t key;
+        uint32_t position;
+    };
+
+    std::vector<positioned_key_t> sortedKeys_;
+    vector_key_views_t groupedKeys_;
+    std::vector<hashslot_key_group_t> groups_;
+    std::vector<uint32_t> keyIndexByPosition_;
+
+    void groupSortedKeys();
+
+public:
+    /**
+     * Replace the current groups with the groups for keys.
+     *
+     * @param keys the Redis keys and their precomputed hashslots
+     */
+    void group(std::span<const hashslot_key_t> keys);
+
+    /**
+     * Replace the current groups with the groups for keys, calculating
+     * the hashslot of every key.
+     *
+     * @param keys the Redis keys
+     */
+    void group(std::span<const std::string_view> keys);
+
+    [[nodiscard]] const std::vector<hashslot_key_group_t>& getGroups() const {
+        return groups_;
+    }
+
+    /**
+     * Return the number of distinct keys in all groups.
+     */
+    [[nodiscard]] size_t getKeyCount() const {
+        return groupedKeys_.size();
+    }
+
+    /**
+     * Return the index, among the distinct keys, of each input key in
+     * input order.
+     */
+    [[nodiscard]] std::span<const uint32_t> getKeyIndexByPosition() const {
+        return keyIndexByPosition_;
+    }
+
+    /**
+     * Return the index of the first distinct key of a span taken from
+     * one of the groups.
+     *
+     * @param keys a span of the keys of a group
+     * @return the index of keys.front() among the distinct keys
+     */
+    [[nodiscard]] size_t getKeyIndex(std::span<const std::string_view> keys) const {
+        return (size_t)(keys.data() - groupedKeys_.data());
+    }
+};
+
+/**
+ * Return the HashslotKeyGroups instance owned by the calling thread.
+ *
+ * @return the per-thread grouping structure
+ */
+HashslotKeyGroups& getThreadHashslotKeyGroups();
+
 /**
  * Divide the keys into hashslot groups and return the resulting groups.
  *
  * @param keys the Redis key strings
  * @param hashslotGroups the resulting groups of keys
  */
-void groupKeysByRedisHashslot(vector_keys_t& keys, hashslot_key_groups_t& hashslotGroups);
+void groupKeysByRedisHashslot(const vector_key_views_t& keys, HashslotKeyGroups& hashslotGroups);
+
+/**
+ * Divide keys with precomputed hashslots into hashslot groups and return
+ * the resulting groups. No CRC16 calculation is performed.
+ *
+ * @param keys the Redis keys and their hashslots
+ * @param hashslotGroups the resulting groups of keys
+ */
+void groupKeysByRedisHashslot(const vector_hashslot_keys_t& keys, HashslotKeyGroups& hashslotGroups);
 
 /**
  * Get the Redis key string corresponding to the provided featureID.
@@ -53,9 +147,9 @@ std::string getKeyForFeatureID(const std::string& redisKeyPrefix, const std::str
  * @param featureID the Redis key string for the feature
  * @param redisKeyPrefix the Redis key prefix in use
  * @param refisKeySuffix the Redis key suffix in use
- * @return the int64 featureID portion of the key
+ * @return the int64 featureID portion of the key, as a view into the key
  */
-std::string getFeatureIDFromKey(const std::string& redisKeyPrefix, const std::string& redisKeySuffix, const std::string& featureID);
+std::string_view getFeatureIDFromKey(const std::string& redisKeyPrefix, const std::string& redisKeySuffix, std::string_view featureID);
 
 /*
  * CRC16 implementation configured to match Redis CRC16 calculation
@@ -80,10 +174,10 @@ static const bool redisHashslotReflectOutput = false;
  */
 class RedisHashSlotGenerator {
 public:
-    ~RedisHashSlotGenerator() = default;
-    virtual uint16_t crc16(const std::string& data) = 0;
-    std::string getRedisHashtag(const std::string& key);
-    uint16_t getHashslotForKey(const std::string& key);
+    virtual ~RedisHashSlotGenerator() = default;
+    virtual uint16_t crc16(std::string_view data) = 0;
+    std::string_view getRedisHashtag(std::string_view key);
+    uint16_t getHashslotForKey(std::string_view key);
 };
 
 /**
@@ -105,7 +199,7 @@ private:
 public:
     SingletonRedisHashSlotGenerator() = default;
 
-    uint16_t crc16(const std::string& data) override;
+    uint16_t crc16(std::string_view data) override;
 };
 
 /**
@@ -116,7 +210,7 @@ private:
 public:
     EphemeralRedisHashSlotGenerator() = default;
 
-    uint16_t crc16(const std::string& data) override;
+    uint16_t crc16(std::string_view data) override;
 };
 
 /**
@@ -127,9 +221,62 @@ private:
 public:
     RedisPlusPlusHashSlotGenerator() = default;
 
-    uint16_t crc16(const std::string& data) override;
+    uint16_t crc16(std::string_view data) override;
+};
+
+/**
+ * Lock-free CRC 16 generator using slicing-by-8 lookup tables.
+ */
+class TableRedisHashSlotGenerator : public RedisHashSlotGenerator {
+private:
+public:
+    TableRedisHashSlotGenerator() = default;
+
+    uint16_t crc16(std::string_view data) override;
 };
 
+/**
+ * Lock-free CRC 16 generator using carry-less multiplication for long
+ * inputs. Only usable on CPUs with PCLMULQDQ support.
+ */
+class ClmulRedisHashSlotGenerator : public RedisHashSlotGenerator {
+private:
+public:
+    ClmulRedisHashSlotGenerator() = default;
+
+    uint16_t crc16(std::string_view data) override;
+};
+
+/**
+ * CRC engines available to getRedisHashslotGenerator().
+ */
+enum class CrcEngine
+{
+    clmul,
+    table,
+    redisPlusPlus,
+    singleton,
+    ephemeral
+};
+
+/**
+ * Select the CRC engine used for hashslot calculation. The fastest engine
+ * supported by the CPU is used unless the REDIS_CRC_ENGINE environment
+ * variable names one of: clmul, table, redis++, singleton, ephemeral.
+ * The selection is made once per process.
+ *
+ * @return the selected engine
+ */
+CrcEngine getRedisHashslotCrcEngine();
+
+std::string crcEngineToString(CrcEngine engine);
+
+/**
+ * Return the process wide hashslot generator for the selected CRC engine.
+ * The generator is owned by this module and must not be deleted.
+ *
+ * @return the hashslot generator instance
+ */
 RedisHashSlotGenerator* getRedisHashslotGenerator();
 
 std::string makeRedisAddressString(const std::string& host, int port);
@@ -158,4 +305,14 @@ long long findPercentile(int percentile, std::vector<long long>* data);
  */
 double findAverage(std::vector<long long>* data);
 
+/**
+ * Count the keys found by a fetch and the bytes of their values.
+ *
+ * @param results the results of a fetch, nullopt for missing keys
+ * @param fetchedBytes set to the total size of the values found
+ *
+ * @return the number of values found
+ */
+size_t countFetchedObjects(const vector_results_t& results, size_t& fetchedBytes);
+
 }  // namespace redis_store
\ No newline at end of file
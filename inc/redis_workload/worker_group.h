@@ -0,0 +1,123 @@
+/**
+ * @file redis_workload/worker_group.h
+ *
+ * @brief Forked worker processes that start their runs together
+ */
+#pragma once
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace query_runner {
+
+/**
+ * A group of worker processes forked from one parent, sharing an
+ * anonymous shared memory mapping created before the fork.
+ *
+ * The mapping holds a process-shared barrier, so the workers can start
+ * every run together, and one results area per worker, where the worker
+ * appends the serialized results of each run for the parent to read once
+ * the workers have exited.
+ */
+class WorkerGroup {
+public:
+    // Results area reserved per worker, only the pages written are used
+    static constexpr size_t kDefaultResultCapacity = 16 * 1024 * 1024;
+
+private:
+    struct shared_state_t {
+        pthread_barrier_t barrier;
+    };
+
+    // Followed by the results, one line per run
+    struct result_area_t {
+        size_t size;
+    };
+
+    unsigned int workerCount_;
+    size_t resultCapacity_;
+    size_t mappingSize_;
+    void* mapping_ = nullptr;
+
+    std::vector<pid_t> workerPids_;
+    // The index of this process in the group, -1 in the parent
+    int workerIndex_ = -1;
+
+    shared_state_t* getSharedState();
+
+    result_area_t* getResultArea(unsigned int workerIndex);
+
+public:
+    WorkerGroup() = delete;
+
+    /**
+     * Create the shared memory mapping and the barrier, before any worker
+     * is forked.
+     *
+     * @param workerCount the number of worker processes
+     * @param resultCapacity the bytes of results each worker can append
+     * @throws std::runtime_error if the mapping or barrier cannot be created.
+     */
+    explicit WorkerGroup(unsigned int workerCount, size_t resultCapacity = kDefaultResultCapacity);
+
+    WorkerGroup(const WorkerGroup&) = delete;
+    WorkerGroup& operator=(const WorkerGroup&) = delete;
+
+    ~WorkerGroup();
+
+    /**
+     * Fork the workers. Each worker calls workerMain with its index, from
+     * 0, and exits with the returned status without returning from start.
+     * The parent must not have started any threads, they do not survive
+     * the fork.
+     *
+     * @param workerMain the body of a worker process
+     * @throws std::runtime_error if a worker cannot be forked.
+     */
+    void start(const std::function<int(unsigned int)>& workerMain);
+
+    /**
+     * Called by a worker: wait until every worker has reached the barrier.
+     */
+    void arriveAndWait();
+
+    /**
+     * Called by a worker: append the results of one run to its results
+     * area.
+     *
+     * @param result the serialized results, without newlines
+     * @throws std::runtime_error if the results area is full.
+     */
+    void appendResult(const std::string& result);
+
+    /**
+     * Called by the parent: wait for every worker to exit. When a worker
+     * fails the others are terminated, since they would wait for it at the
+     * barrier forever.
+     *
+     * @return true if every worker exited with status 0
+     */
+    bool wait();
+
+    /**
+     * Called by the parent once the workers have exited.
+     *
+     * @param workerIndex the worker
+     * @return the results appended by the worker, in order
+     */
+    std::vector<std::string> getResults(unsigned int workerIndex);
+
+    unsigned int getWorkerCount() const;
+
+    /**
+     * @return the index of this worker, -1 in the parent
+     */
+    int getWorkerIndex() const;
+};
+
+}  // namespace query_runner
@@ -0,0 +1,65 @@
+/**
+ * @file redis_workload/writer_reader_phaser.h
+ *
+ * @brief Wait-free writer, blocking reader phase flip for double buffering
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace redis_store {
+
+/**
+ * Coordinates writers recording into the active one of two buffers with a
+ * reader that swaps the buffers and reads the inactive one, as in the
+ * HdrHistogram WriterReaderPhaser.
+ *
+ * A writer wraps each update in writerCriticalSectionEnter() and
+ * writerCriticalSectionExit(), each a single atomic increment. The reader
+ * holds readerLock(), swaps the active buffer pointer and then calls
+ * flipPhase(), which returns once every writer that could still see the
+ * old buffer has left its critical section. Writers never wait.
+ */
+class WriterReaderPhaser {
+private:
+    std::atomic<int64_t> startEpoch_ {0};
+    std::atomic<int64_t> evenEndEpoch_ {0};
+    std::atomic<int64_t> oddEndEpoch_ {INT64_MIN};
+    std::mutex readerMutex_;
+
+public:
+    /**
+     * Enter a writer critical section.
+     *
+     * @return the value to pass to writerCriticalSectionExit
+     */
+    int64_t writerCriticalSectionEnter() {
+        return startEpoch_.fetch_add(1);
+    }
+
+    void writerCriticalSectionExit(int64_t criticalValueAtEnter) {
+        if (criticalValueAtEnter < 0) {
+            oddEndEpoch_.fetch_add(1);
+        }
+        else {
+            evenEndEpoch_.fetch_add(1);
+        }
+    }
+
+    /**
+     * @return the lock that serializes readers, held around flipPhase
+     */
+    std::mutex& readerLock() {
+        return readerMutex_;
+    }
+
+    /**
+     * Wait for the writers of the current phase to leave their critical
+     * sections. Must be called with readerLock() held.
+     */
+    void flipPhase();
+};
+
+}  // namespace redis_store
@@ -8,10 +8,13 @@ PROCESS_TOTALS="1 2"
 
 PWD=$(pwd)
 
+#### run_redis_workload forks the worker processes itself (-p), starting every run in all
+#### of them together and printing one merged report
 for PROCESS_COUNT in ${PROCESS_TOTALS} ; do
     echo "test run: ${PROCESS_COUNT} processes"
+    export WORKER_PROCESSES=${PROCESS_COUNT}
     mkdir count${PROCESS_COUNT}
     cd count${PROCESS_COUNT}
-    parallel -j ${PROCESS_COUNT} ${SCRIPT_ROOT_DIR}/parallel_test_runner.sh {} ::: $(seq 1 ${PROCESS_COUNT})
+    ${SCRIPT_ROOT_DIR}/run_tests.sh
     cd ..
 done
@@ -27,10 +27,23 @@ THREAD_COUNTS="1"
 #MODE="-r"
 MODE=""
 
+#### Worker processes forked by run_redis_workload, each replaying its own slice of the
+#### data file
+if [ -n "${WORKER_PROCESSES}" ]; then
+    MODE="${MODE} -p ${WORKER_PROCESSES}"
+fi
+
+#### Run each test for a fixed number of seconds, cycling through the queries, so every
+#### runner is busy for the whole measured window; set DURATION="" to run every query once
+DURATION=""
+if [ -n "${DURATION}" ]; then
+    MODE="${MODE} -u ${DURATION}"
+fi
+
 date
 for t in $(echo ${THREAD_COUNTS}); do
     echo $t
-    ${CMD} ${MODE} -t ${t} -f ${DATA} | tee ./${OUTPUT_PREFIX}-${t}.txt
+    ${CMD} ${MODE} -t ${t} -f ${DATA} -J ./${OUTPUT_PREFIX}-${t}.json | tee ./${OUTPUT_PREFIX}-${t}.txt
     sleep 1
 done
 cd ${PWD}
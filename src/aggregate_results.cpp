@@ -0,0 +1,173 @@
+#include <getopt.h>
+#include <json/json.h>
+#include <redis_workload/run_results.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using query_runner::RunResults;
+
+/**
+ * The results files of one test: the files with the same name under one
+ * command line argument, for example count4/data-{1..4}/threads-1.json.
+ */
+struct test_results_t {
+    std::vector<std::string> files;
+    // In run order
+    std::vector<RunResults> runs;
+
+    RunResults& getRun(const std::string& name) {
+        for (auto& run : runs) {
+            if (run.getName() == name) {
+                return run;
+            }
+        }
+        runs.emplace_back(name);
+        return runs.back();
+    }
+};
+
+void usage(const std::string& appName) {
+    std::cout << appName << std::endl;
+    std::cout << "Combine the json results files written by run_redis_workload -J into throughput and percentiles" << std::endl
+              << "across processes. The latency histograms of the files are merged, so the percentiles are those" << std::endl
+              << "of all the queries rather than an average of per-process percentiles." << std::endl;
+
+    std::cout << std::endl;
+    std::cout << "usage: " << appName << " [-o <results.json>] <directory or file>..." << std::endl;
+    std::cout << "where:" << std::endl;
+    std::cout << "    -o <filename>    also write the combined results to a json file" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Directories are searched for results files. Files with the same name under one argument are" << std::endl
+              << "combined, so 'count*' gives one line per run and thread count for every process count." << std::endl;
+}
+
+/**
+ * Read a results file, returning false for json files that are not
+ * results, such as interval reports.
+ */
+bool readResults(const std::string& filename, Json::Value& results) {
+    std::ifstream input(filename);
+    if (!input) {
+        std::cout << "warn: could not open " << filename << std::endl;
+        return false;
+    }
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    if (!Json::parseFromStream(builder, input, &results, &errors) || !results.isObject()) {
+        return false;
+    }
+    return results.isMember("runs") && results["runs"].isArray();
+}
+
+void addResults(test_results_t& test, const std::string& filename, const Json::Value& results) {
+    test.files.push_back(filename);
+    for (const auto& runResult : results["runs"]) {
+        try {
+            test.getRun(runResult["name"].asString()).add(runResult);
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << "error: " << filename << ": " << e.what() << std::endl;
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::string appName(basename(*argv));
+
+    std::string outputFileName;
+
+    std::string argumentTemplate = "o:h";
+    const struct option longOptions[] = {{"output", required_argument, nullptr, 'o'},
+                                         {"help", no_argument, nullptr, 'h'},
+                                         {nullptr, 0, nullptr, 0}};
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, argumentTemplate.c_str(), longOptions, nullptr)) != -1) {
+        switch (ch) {
+            case 'o':
+                outputFileName = std::string(optarg);
+                break;
+            case 'h':
+                usage(appName);
+                exit(0);
+            case '?':
+            default: {
+                usage(appName);
+                exit(0);
+            }
+        }
+    }
+
+    if (optind >= argc) {
+        std::cerr << "error: no results directories or files given" << std::endl;
+        exit(1);
+    }
+
+    // Keyed by argument and file name, sorted so the tests print in order
+    std::map<std::pair<std::string, std::string>, test_results_t> tests;
+    for (int i = optind; i < argc; i++) {
+        std::string argument(argv[i]);
+        std::vector<std::filesystem::path> candidates;
+        std::error_code error;
+        if (std::filesystem::is_directory(argument, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(argument, error)) {
+                if (entry.is_regular_file() && (entry.path().extension() == ".json")) {
+                    candidates.push_back(entry.path());
+                }
+            }
+        }
+        else if (std::filesystem::is_regular_file(argument, error)) {
+            candidates.emplace_back(argument);
+        }
+        else {
+            std::cout << "warn: no such results directory or file: " << argument << std::endl;
+            continue;
+        }
+
+        for (const auto& path : candidates) {
+            Json::Value results;
+            if (readResults(path.string(), results)) {
+                addResults(tests[{argument, path.filename().string()}], path.string(), results);
+            }
+        }
+    }
+
+    if (tests.empty()) {
+        std::cerr << "error: no results files found" << std::endl;
+        exit(1);
+    }
+
+    Json::Value combined(Json::arrayValue);
+    for (auto& [key, test] : tests) {
+        std::string testName = key.first + " " + key.second;
+        for (const auto& run : test.runs) {
+            std::cout << run.toString(testName + " " + run.getName());
+
+            Json::Value runJson = run.toJson();
+            runJson["source"] = key.first;
+            runJson["file"] = key.second;
+            combined.append(runJson);
+        }
+        std::cout << std::endl;
+    }
+
+    if (!outputFileName.empty()) {
+        std::ofstream output(outputFileName);
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "  ";
+        output << Json::writeString(builder, combined) << std::endl;
+        if (!output) {
+            std::cerr << "error: could not write " << outputFileName << std::endl;
+            exit(1);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <redis_workload/allocation_counter.h>
+
+#ifdef COUNT_ALLOCATIONS
+    #include <cstdlib>
+    #include <new>
+
+static thread_local unsigned long long threadAllocationCount = 0;
+
+void* operator new(std::size_t size) {
+    threadAllocationCount++;
+    void* p = std::malloc((size > 0) ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    threadAllocationCount++;
+    return std::malloc((size > 0) ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+// Types aligned beyond __STDCPP_DEFAULT_NEW_ALIGNMENT__ allocate here
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    threadAllocationCount++;
+    // aligned_alloc takes a size that is a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void* p = std::aligned_alloc(align, (((size > 0) ? size : 1) + align - 1) & ~(align - 1));
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, alignment);
+    }
+    catch (std::bad_alloc& e) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept {
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+#endif  // COUNT_ALLOCATIONS
+
+namespace redis_store {
+
+unsigned long long getThreadAllocationCount() {
+#ifdef COUNT_ALLOCATIONS
+    return threadAllocationCount;
+#else
+    return 0;
+#endif  // COUNT_ALLOCATIONS
+}
+
+bool allocationCountingEnabled() {
+#ifdef COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif  // COUNT_ALLOCATIONS
+}
+
+}  // namespace redis_store
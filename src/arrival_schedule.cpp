@@ -0,0 +1,56 @@
+#include <redis_workload/arrival_schedule.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace query_runner {
+
+ArrivalDistribution arrivalDistributionFromString(const std::string& name) {
+    if (name == "fixed") {
+        return ArrivalDistribution::fixed;
+    }
+    if (name == "poisson") {
+        return ArrivalDistribution::poisson;
+    }
+    throw std::runtime_error("Unknown arrival distribution: " + name);
+}
+
+std::string arrivalDistributionToString(ArrivalDistribution distribution) {
+    switch (distribution) {
+        case ArrivalDistribution::fixed:
+            return "fixed";
+        case ArrivalDistribution::poisson:
+            return "poisson";
+    }
+    return "unknown";
+}
+
+ArrivalSchedule::ArrivalSchedule(double ratePerSecond, ArrivalDistribution distribution, uint64_t seed, double phase) :
+    intervalNanos_(1e9 / ratePerSecond),
+    distribution_(distribution),
+    generator_(seed),
+    gapDistribution_(1.0),
+    nextArrivalNanos_(0.0) {
+    if (!(ratePerSecond > 0.0)) {
+        throw std::runtime_error("Arrival rate must be positive");
+    }
+    nextArrivalNanos_ = ((distribution_ == ArrivalDistribution::fixed) ? (phase * intervalNanos_) : nextGapNanos());
+}
+
+double ArrivalSchedule::nextGapNanos() {
+    switch (distribution_) {
+        case ArrivalDistribution::fixed:
+            return intervalNanos_;
+        case ArrivalDistribution::poisson:
+            return gapDistribution_(generator_) * intervalNanos_;
+    }
+    return intervalNanos_;
+}
+
+std::chrono::nanoseconds ArrivalSchedule::next() {
+    auto arrival = std::chrono::nanoseconds((long long)nextArrivalNanos_);
+    nextArrivalNanos_ += nextGapNanos();
+    return arrival;
+}
+
+}  // namespace query_runner
@@ -0,0 +1,142 @@
+#include <redis_workload/capacity_search.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace query_runner {
+
+CapacitySearch::CapacitySearch(int64_t p99SloMicro, double startLoad, double maxLoad, bool integerLoad, double precision, const std::string& loadName) :
+    p99SloMicro_(p99SloMicro),
+    startLoad_(startLoad),
+    maxLoad_(std::max(maxLoad, startLoad)),
+    integerLoad_(integerLoad),
+    precision_(precision),
+    loadName_(loadName) {}
+
+void CapacitySearch::run(const std::function<capacity_probe_t(double load)>& probe) {
+    probes_.clear();
+
+    auto probeAt = [&](double load) {
+        capacity_probe_t result = probe(load);
+        result.load = load;
+        result.withinSlo = (result.p99Micro <= p99SloMicro_);
+        probes_.push_back(result);
+        return result.withinSlo;
+    };
+
+    // Highest load within the SLO and lowest load missing it, 0 for none
+    double passing = 0.0;
+    double failing = 0.0;
+
+    double load = startLoad_;
+    while (probes_.size() < kMaxProbes) {
+        if (!probeAt(load)) {
+            failing = load;
+            break;
+        }
+        passing = load;
+        if (load >= maxLoad_) {
+            return;
+        }
+        load = std::min(load * 2, maxLoad_);
+    }
+
+    // The start load already misses the SLO. There is no passing load to
+    // bisect towards, and halving a rate from there has no floor
+    if (passing == 0.0) {
+        return;
+    }
+
+    while ((failing > 0.0) && (probes_.size() < kMaxProbes)) {
+        double middle = (passing + failing) / 2;
+        if (integerLoad_) {
+            middle = std::floor(middle);
+            if (middle <= passing) {
+                break;
+            }
+        }
+        else if ((failing - passing) <= (precision_ * failing)) {
+            break;
+        }
+
+        if (probeAt(middle)) {
+            passing = middle;
+        }
+        else {
+            failing = middle;
+        }
+    }
+}
+
+const std::vector<capacity_probe_t>& CapacitySearch::getProbes() const {
+    return probes_;
+}
+
+const capacity_probe_t* CapacitySearch::getCapacity() const {
+    const capacity_probe_t* capacity = nullptr;
+    for (const auto& probe : probes_) {
+        if (probe.withinSlo && ((capacity == nullptr) || (probe.load > capacity->load))) {
+            capacity = &probe;
+        }
+    }
+    return capacity;
+}
+
+/**
+ * Format a load, without a fraction for whole loads such as thread counts.
+ */
+static std::string loadToString(double load, bool integerLoad) {
+    return integerLoad ? std::to_string((long long)load) : std::to_string(load);
+}
+
+std::string CapacitySearch::toString() const {
+    std::vector<capacity_probe_t> curve = probes_;
+    std::sort(curve.begin(), curve.end(), [](const capacity_probe_t& a, const capacity_probe_t& b) {
+        return a.load < b.load;
+    });
+
+    std::stringstream sstream;
+    sstream << "Latency curve, p99 SLO " << std::to_string(p99SloMicro_) << " microseconds:" << std::endl;
+    for (const auto& probe : curve) {
+        sstream << "  " << loadName_ << " " << loadToString(probe.load, integerLoad_) << ": " << std::to_string(probe.queriesPerSecond) << " queries/s, p50 "
+                << std::to_string(probe.p50Micro) << ", p99 " << std::to_string(probe.p99Micro) << " microseconds"
+                << (probe.withinSlo ? "" : ", over SLO") << std::endl;
+    }
+
+    const capacity_probe_t* capacity = getCapacity();
+    if (capacity == nullptr) {
+        sstream << "Capacity: none, the starting " << loadName_ << " missed the p99 SLO" << std::endl;
+    }
+    else {
+        sstream << "Capacity: " << std::to_string(capacity->queriesPerSecond) << " queries/s at " << loadName_ << " " << loadToString(capacity->load, integerLoad_)
+                << ", p99 " << std::to_string(capacity->p99Micro) << " microseconds" << std::endl;
+    }
+    return sstream.str();
+}
+
+Json::Value CapacitySearch::toJson() const {
+    Json::Value search;
+    search["load"] = loadName_;
+    search["p99_slo_us"] = (Json::Int64)p99SloMicro_;
+    search["probes"] = Json::Value(Json::arrayValue);
+    for (const auto& probe : probes_) {
+        Json::Value probeJson;
+        probeJson[loadName_] = probe.load;
+        probeJson["queries_per_second"] = probe.queriesPerSecond;
+        probeJson["p50_us"] = (Json::Int64)probe.p50Micro;
+        probeJson["p99_us"] = (Json::Int64)probe.p99Micro;
+        probeJson["within_slo"] = probe.withinSlo;
+        search["probes"].append(probeJson);
+    }
+
+    const capacity_probe_t* capacity = getCapacity();
+    if (capacity != nullptr) {
+        search["capacity_queries_per_second"] = capacity->queriesPerSecond;
+        search["capacity_" + loadName_] = capacity->load;
+    }
+    return search;
+}
+
+}  // namespace query_runner
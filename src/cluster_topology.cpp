@@ -0,0 +1,131 @@
+#include <redis_workload/cluster_topology.h>
+#include <redis_workload/util.h>
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace redis_store {
+
+ClusterTopology::ClusterTopology() : slotNodes_(kHashslotCount, kUnassignedNode) {}
+
+/**
+ * Split s on a separator character, skipping empty fields.
+ */
+static std::vector<std::string_view> splitFields(std::string_view s, char separator) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t end = s.find(separator, start);
+        if (end == std::string_view::npos) {
+            end = s.size();
+        }
+        if (end > start) {
+            fields.push_back(s.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return fields;
+}
+
+static size_t parseNumber(std::string_view field, size_t limit) {
+    size_t value = 0;
+    auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if ((ec != std::errc()) || (ptr != field.data() + field.size()) || (value >= limit)) {
+        throw std::runtime_error("Invalid number in CLUSTER NODES reply: " + std::string(field));
+    }
+    return value;
+}
+
+static size_t parseSlotNumber(std::string_view field) {
+    return parseNumber(field, ClusterTopology::kHashslotCount);
+}
+
+ClusterTopology ClusterTopology::fromClusterNodes(std::string_view clusterNodes) {
+    ClusterTopology topology;
+
+    // <id> <ip:port@cport[,hostname]> <flags> <master> <ping-sent> <pong-recv> <config-epoch> <link-state> <slot> <slot> ...
+    for (std::string_view line : splitFields(clusterNodes, '\n')) {
+        if (line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        std::vector<std::string_view> fields = splitFields(line, ' ');
+        if (fields.size() < 8) {
+            throw std::runtime_error("Invalid CLUSTER NODES line: " + std::string(line));
+        }
+
+        std::vector<std::string_view> flags = splitFields(fields[2], ',');
+        if (std::find(flags.begin(), flags.end(), "master") == flags.end() || (fields.size() == 8)) {
+            continue;
+        }
+
+        std::string_view address = fields[1].substr(0, fields[1].find_first_of("@,"));
+        size_t portSeparator = address.rfind(':');
+        if (portSeparator == std::string_view::npos) {
+            throw std::runtime_error("Invalid node address in CLUSTER NODES reply: " + std::string(fields[1]));
+        }
+
+        if (topology.nodes_.size() == kUnassignedNode) {
+            throw std::runtime_error("Too many nodes in CLUSTER NODES reply");
+        }
+        auto node = (uint16_t)topology.nodes_.size();
+        cluster_node_t clusterNode {std::string(fields[0]), std::string(address.substr(0, portSeparator)), 0, "", 0};
+        clusterNode.port = (int)parseNumber(address.substr(portSeparator + 1), 65536);
+
+        for (size_t i = 8; i < fields.size(); i++) {
+            // Skip the [slot->-node] and [slot-<-node] migration markers
+            if (fields[i].front() == '[') {
+                continue;
+            }
+            size_t rangeSeparator = fields[i].find('-');
+            size_t first = parseSlotNumber(fields[i].substr(0, rangeSeparator));
+            size_t last = ((rangeSeparator == std::string_view::npos) ? first : parseSlotNumber(fields[i].substr(rangeSeparator + 1)));
+            for (size_t slot = first; slot <= last; slot++) {
+                topology.slotNodes_[slot] = node;
+            }
+            clusterNode.slotCount += (last >= first) ? (last - first + 1) : 0;
+        }
+        topology.nodes_.push_back(std::move(clusterNode));
+    }
+
+    topology.assignHashtags();
+    return topology;
+}
+
+void ClusterTopology::assignHashtags() {
+    RedisHashSlotGenerator* hashSlotGenerator = getRedisHashslotGenerator();
+
+    // Search the integers for a hashtag landing on each node. A node owning
+    // k of the 16384 slots needs about 16384/k attempts.
+    size_t remaining = std::count_if(nodes_.begin(), nodes_.end(), [](const cluster_node_t& n) {
+        return n.slotCount > 0;
+    });
+    for (unsigned long i = 0; (remaining > 0) && (i < 16 * kHashslotCount); i++) {
+        std::string hashtag = std::to_string(i);
+        uint16_t node = slotNodes_[hashSlotGenerator->getHashslotForKey(hashtag)];
+        if ((node != kUnassignedNode) && nodes_[node].hashtag.empty()) {
+            nodes_[node].hashtag = std::move(hashtag);
+            remaining--;
+        }
+    }
+}
+
+size_t ClusterTopology::getUnassignedSlotCount() const {
+    return std::count(slotNodes_.begin(), slotNodes_.end(), kUnassignedNode);
+}
+
+std::string ClusterTopology::toString() const {
+    std::stringstream sstream;
+    for (const cluster_node_t& node : nodes_) {
+        sstream << "    node " << node.id << " " << node.host << ":" << std::to_string(node.port) << " slots: " << std::to_string(node.slotCount)
+                << " hashtag: " << node.hashtag << std::endl;
+    }
+    if (getUnassignedSlotCount() > 0) {
+        sstream << "    unassigned slots: " << std::to_string(getUnassignedSlotCount()) << std::endl;
+    }
+    return sstream.str();
+}
+
+}  // namespace redis_store
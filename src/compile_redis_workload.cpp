@@ -0,0 +1,106 @@
+#include <getopt.h>
+#include <redis_workload/query_runner.h>
+#include <redis_workload/query_workload.h>
+
+#include <boost/chrono.hpp>
+#include <iostream>
+#include <string>
+
+using query_runner::OperationMode;
+using query_runner::QueryListCollector;
+using query_runner::QueryWorkload;
+
+void usage(const std::string& appName) {
+    std::cout << appName << std::endl;
+    std::cout << "Convert a CSV workload file into the binary workload format read by run_redis_workload." << std::endl
+              << "The binary file holds the interned keys, the hashslot of every key and the query" << std::endl
+              << "boundaries, so run_redis_workload can memory map it without parsing or hashing." << std::endl;
+
+    std::cout << std::endl;
+    std::cout << "usage: " << appName << " -f <data.csv> -o <data.rwl>" << std::endl;
+    std::cout << "where:" << std::endl;
+    std::cout << "    -f <filename>    data file to convert (csv format)" << std::endl;
+    std::cout << "    -o <filename>    binary workload file to write" << std::endl;
+    std::cout << "    -j <n>           number of threads used to parse the data file (default 1)" << std::endl;
+    std::cout << "    -T               the first column of the data file is the time each query was sent, in seconds" << std::endl
+              << "                     since the epoch with an optional fraction, stored for replay" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string appName(basename(*argv));
+
+    int parseThreadCount = 1;
+    std::string datafileName;
+    std::string outputFileName;
+    bool csvQueryTimes = false;
+
+    std::string argumentTemplate = "f:o:j:Th";
+    const struct option longOptions[] = {{"file", required_argument, nullptr, 'f'},
+                                         {"output", required_argument, nullptr, 'o'},
+                                         {"parse-threads", required_argument, nullptr, 'j'},
+                                         {"query-times", no_argument, nullptr, 'T'},
+                                         {"help", no_argument, nullptr, 'h'},
+                                         {nullptr, 0, nullptr, 0}};
+
+    int ch;
+    while ((ch = getopt_long(argc, argv, argumentTemplate.c_str(), longOptions, nullptr)) != -1) {
+        switch (ch) {
+            case 'f':
+                datafileName = std::string(optarg);
+                break;
+            case 'o':
+                outputFileName = std::string(optarg);
+                break;
+            case 'j':
+                try {
+                    parseThreadCount = std::stoi(optarg);
+                }
+                catch (std::invalid_argument& e) {
+                    std::cerr << "error: parse thread count argument invalid" << std::endl;
+                    exit(1);
+                };
+                break;
+            case 'T':
+                csvQueryTimes = true;
+                break;
+            case 'h':
+                usage(appName);
+                exit(0);
+            case '?':
+            default: {
+                usage(appName);
+                exit(0);
+            }
+        }
+    }
+
+    if (datafileName.empty() || outputFileName.empty()) {
+        std::cerr << "error: both an input and an output file are required" << std::endl;
+        exit(1);
+    }
+
+    if (parseThreadCount < 1) {
+        std::cerr << "error: invalid parse thread count requested" << std::endl;
+        exit(1);
+    }
+
+    auto timer = boost::chrono::steady_clock::now();
+
+    QueryListCollector collector(1, OperationMode::divide);
+    collector.setCsvQueryTimes(csvQueryTimes);
+    try {
+        collector.parseCsvIntoBuckets(datafileName, parseThreadCount);
+        collector.getWorkload()->writeBinaryFile(outputFileName);
+    }
+    catch (std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    auto elapsed = boost::chrono::duration_cast<boost::chrono::milliseconds>(boost::chrono::steady_clock::now() - timer);
+
+    std::cout << std::endl;
+    std::cout << "Wrote " << outputFileName << ": " << std::to_string(collector.getWorkload()->getBinaryImageSize()) << " bytes in "
+              << std::to_string(elapsed.count()) << " milliseconds" << std::endl;
+    return 0;
+}
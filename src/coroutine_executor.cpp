@@ -0,0 +1,76 @@
+#include <redis_workload/coroutine_executor.h>
+#include <redis_workload/util.h>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace query_runner {
+
+CoroutineExecutor::CoroutineExecutor(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(boost::thread::hardware_concurrency(), 1U);
+    }
+    threads_.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads_.emplace_back(&CoroutineExecutor::work, this);
+    }
+}
+
+CoroutineExecutor::~CoroutineExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    readyCondition_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+void CoroutineExecutor::schedule(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        readyQueue_.push_back(handle);
+    }
+    readyCondition_.notify_one();
+}
+
+void CoroutineExecutor::work() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            readyCondition_.wait(lock, [this]() {
+                return stopping_ || !readyQueue_.empty();
+            });
+            if (readyQueue_.empty()) {
+                return;
+            }
+            handle = readyQueue_.front();
+            readyQueue_.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+void FetchAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    // The callback may resume the coroutine, and so destroy this awaitable,
+    // before fetchByFeatureKeysAsync returns: nothing here may touch this
+    // after the call
+    CoroutineExecutor& executor = executor_;
+    dataStore_.fetchByFeatureKeysAsync(keys_, [this, handle, &executor](redis_store::vector_results_t& results, std::exception_ptr error) {
+        fetchedCount_ = redis_store::countFetchedObjects(results, fetchedBytes_);
+        error_ = std::move(error);
+        executor.schedule(handle);
+    });
+}
+
+size_t FetchAwaitable::await_resume() {
+    if (error_ != nullptr) {
+        std::rethrow_exception(error_);
+    }
+    return fetchedCount_;
+}
+
+}  // namespace query_runner
@@ -0,0 +1,167 @@
+#include <pthread.h>
+#include <redis_workload/cpu_affinity.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace redis_store {
+
+static int parseCpu(const std::string& cpu, const std::string& cpuList) {
+    size_t parsed = 0;
+    int result = -1;
+    try {
+        result = std::stoi(cpu, &parsed);
+    }
+    catch (std::logic_error& e) {
+        parsed = 0;
+    }
+    if ((parsed == 0) || (parsed != cpu.size()) || (result < 0) || (result >= CPU_SETSIZE)) {
+        throw std::invalid_argument("invalid CPU list: " + cpuList);
+    }
+    return result;
+}
+
+std::vector<int> parseCpuList(const std::string& cpuList) {
+    std::vector<int> cpus;
+    std::stringstream ranges(cpuList);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        if (dash == std::string::npos) {
+            cpus.push_back(parseCpu(range, cpuList));
+            continue;
+        }
+        int first = parseCpu(range.substr(0, dash), cpuList);
+        int last = parseCpu(range.substr(dash + 1), cpuList);
+        if (last < first) {
+            throw std::invalid_argument("invalid CPU list: " + cpuList);
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        throw std::invalid_argument("empty CPU list");
+    }
+    return cpus;
+}
+
+std::string formatCpuList(const std::vector<int>& cpus) {
+    std::string cpuList;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t last = i;
+        while ((last + 1 < cpus.size()) && (cpus[last + 1] == cpus[last] + 1)) {
+            last++;
+        }
+        if (!cpuList.empty()) {
+            cpuList += ",";
+        }
+        cpuList += std::to_string(cpus[i]);
+        if (last > i) {
+            cpuList += "-" + std::to_string(cpus[last]);
+        }
+        i = last + 1;
+    }
+    return cpuList;
+}
+
+void setThreadAffinity(const std::vector<int>& cpus) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (result != 0) {
+        throw std::runtime_error("Cannot set the CPU affinity to " + formatCpuList(cpus) + ": " + std::strerror(result));
+    }
+}
+
+std::vector<int> getThreadAffinity() {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    std::vector<int> cpus;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpuSet)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * Read a CPU or node list from sysfs, empty if the file is missing.
+ */
+static std::vector<int> readSysfsList(const std::string& path) {
+    std::ifstream input(path);
+    std::string list;
+    if (!input || !std::getline(input, list) || list.empty()) {
+        return {};
+    }
+    try {
+        return parseCpuList(list);
+    }
+    catch (std::invalid_argument& e) {
+        return {};
+    }
+}
+
+std::vector<int> getNumaNodeCpus(int node) {
+    return readSysfsList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+}
+
+std::vector<int> getNumaNodes() {
+    return readSysfsList("/sys/devices/system/node/online");
+}
+
+std::vector<int> getNumaNodesOfCpus(const std::vector<int>& cpus) {
+    std::vector<int> nodes;
+    for (int node : getNumaNodes()) {
+        std::vector<int> nodeCpus = getNumaNodeCpus(node);
+        for (int cpu : cpus) {
+            if (std::find(nodeCpus.begin(), nodeCpus.end(), cpu) != nodeCpus.end()) {
+                nodes.push_back(node);
+                break;
+            }
+        }
+    }
+    return nodes;
+}
+
+std::vector<std::vector<int>> parseCpuPlacement(const std::string& placement) {
+    static const std::string kNodePrefix = "node:";
+
+    std::vector<std::vector<int>> cpuSets;
+    if (placement.compare(0, kNodePrefix.size(), kNodePrefix) == 0) {
+        for (int node : parseCpuList(placement.substr(kNodePrefix.size()))) {
+            std::vector<int> nodeCpus = getNumaNodeCpus(node);
+            if (nodeCpus.empty()) {
+                throw std::invalid_argument("no CPUs found for NUMA node " + std::to_string(node));
+            }
+            cpuSets.push_back(nodeCpus);
+        }
+        return cpuSets;
+    }
+
+    for (int cpu : parseCpuList(placement)) {
+        cpuSets.push_back({cpu});
+    }
+    return cpuSets;
+}
+
+}  // namespace redis_store
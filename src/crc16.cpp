@@ -0,0 +1,126 @@
+#include <redis_workload/crc16.h>
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define REDIS_WORKLOAD_HAVE_CLMUL 1
+#endif
+
+namespace redis_store {
+
+static constexpr uint16_t kCrc16Poly = 0x1021;
+
+typedef std::array<std::array<uint16_t, 256>, 8> crc16_tables_t;
+
+/**
+ * Build the slicing-by-8 tables. tables[0] is the classic byte-at-a-time
+ * table, tables[k] advances a byte's contribution by k further zero bytes.
+ */
+static constexpr crc16_tables_t makeCrc16Tables() {
+    crc16_tables_t tables {};
+    for (unsigned int b = 0; b < 256; b++) {
+        auto crc = static_cast<uint16_t>(b << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? ((crc << 1) ^ kCrc16Poly) : (crc << 1));
+        }
+        tables[0][b] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); k++) {
+        for (unsigned int b = 0; b < 256; b++) {
+            uint16_t prev = tables[k - 1][b];
+            tables[k][b] = static_cast<uint16_t>((prev << 8) ^ tables[0][prev >> 8]);
+        }
+    }
+    return tables;
+}
+
+static constexpr crc16_tables_t kCrc16Tables = makeCrc16Tables();
+
+uint16_t crc16SliceBy8(const char* data, size_t length, uint16_t crc) {
+    const auto* p = reinterpret_cast<const uint8_t*>(data);
+
+    while (length >= 8) {
+        crc = kCrc16Tables[7][p[0] ^ (crc >> 8)] ^ kCrc16Tables[6][p[1] ^ (crc & 0xff)] ^ kCrc16Tables[5][p[2]] ^ kCrc16Tables[4][p[3]]
+              ^ kCrc16Tables[3][p[4]] ^ kCrc16Tables[2][p[5]] ^ kCrc16Tables[1][p[6]] ^ kCrc16Tables[0][p[7]];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = static_cast<uint16_t>((crc << 8) ^ kCrc16Tables[0][(crc >> 8) ^ *p++]);
+    }
+    return crc;
+}
+
+#if defined(REDIS_WORKLOAD_HAVE_CLMUL)
+
+/**
+ * Calculate x^n mod P for the CRC polynomial P = x^16 + 0x1021.
+ */
+static constexpr uint64_t xPowModPoly(unsigned int n) {
+    uint32_t r = 1;
+    for (unsigned int i = 0; i < n; i++) {
+        r <<= 1;
+        if (r & 0x10000) {
+            r ^= 0x10000 | kCrc16Poly;
+        }
+    }
+    return r;
+}
+
+// Folding a 128-bit accumulator A = H * x^64 + L forward by one 128-bit block
+// gives A * x^128 = H * x^192 + L * x^128, reduced modulo P with these constants
+static constexpr uint64_t kFoldHigh = xPowModPoly(192);
+static constexpr uint64_t kFoldLow = xPowModPoly(128);
+
+static const size_t kClmulBlockSize = 16;
+
+__attribute__((target("pclmul,ssse3"))) uint16_t crc16Clmul(const char* data, size_t length) {
+    if (length < 2 * kClmulBlockSize) {
+        return crc16SliceBy8(data, length);
+    }
+
+    // The CRC is most significant bit first, so reverse the bytes of every
+    // block to make the first message byte the top of the 128-bit value
+    const __m128i byteReverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i foldConstants = _mm_set_epi64x(static_cast<long long>(kFoldHigh), static_cast<long long>(kFoldLow));
+
+    __m128i acc = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), byteReverse);
+    size_t pos = kClmulBlockSize;
+    for (; pos + kClmulBlockSize <= length; pos += kClmulBlockSize) {
+        __m128i block = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), byteReverse);
+        __m128i high = _mm_clmulepi64_si128(acc, foldConstants, 0x11);
+        __m128i low = _mm_clmulepi64_si128(acc, foldConstants, 0x00);
+        acc = _mm_xor_si128(_mm_xor_si128(high, low), block);
+    }
+
+    /*
+     * acc is congruent to the folded prefix modulo P. With a zero initial
+     * value the CRC of a message only depends on its value modulo P, so the
+     * CRC of the 16 bytes of acc equals the CRC of the prefix.
+     */
+    char folded[kClmulBlockSize];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(folded), _mm_shuffle_epi8(acc, byteReverse));
+    uint16_t crc = crc16SliceBy8(folded, kClmulBlockSize);
+
+    return crc16SliceBy8(data + pos, length - pos, crc);
+}
+
+bool crc16ClmulSupported() {
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+#else
+
+uint16_t crc16Clmul(const char* data, size_t length) {
+    return crc16SliceBy8(data, length);
+}
+
+bool crc16ClmulSupported() {
+    return false;
+}
+
+#endif  // REDIS_WORKLOAD_HAVE_CLMUL
+
+}  // namespace redis_store
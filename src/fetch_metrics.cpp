@@ -0,0 +1,131 @@
+#include <redis_workload/fetch_metrics.h>
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <sstream>
+#include <string>
+
+namespace redis_store {
+
+const char* fetchStageToString(FetchStage stage) {
+    switch (stage) {
+        case FetchStage::group:
+            return "group";
+        case FetchStage::issue:
+            return "issue";
+        case FetchStage::wait:
+            return "wait";
+        case FetchStage::collect:
+            return "collect";
+    }
+    return "unknown";
+}
+
+size_t FetchMetrics::getSliceSizeBucket(size_t keys) {
+    if (keys == 0) {
+        return 0;
+    }
+    return std::min((size_t)std::bit_width(keys) - 1, kSliceSizeBuckets - 1);
+}
+
+void FetchMetrics::addFetch(size_t keys, size_t roundTrips) {
+    fetchCount_++;
+    keyCount_ += keys;
+    roundTripCount_ += roundTrips;
+}
+
+void FetchMetrics::addSlice(size_t keys, long long latencyMicro) {
+    size_t bucket = getSliceSizeBucket(keys);
+    auto latency = (unsigned long long)std::max(latencyMicro, 0LL);
+
+    sliceCount_++;
+    maxSliceKeys_ = std::max(maxSliceKeys_, (unsigned long long)keys);
+    bucketSliceCounts_[bucket]++;
+    bucketKeyCounts_[bucket] += keys;
+    bucketLatencyMicro_[bucket] += latency;
+    bucketMaxLatencyMicro_[bucket] = std::max(bucketMaxLatencyMicro_[bucket], latency);
+}
+
+void FetchMetrics::addStageTimedFetch() {
+    stageTimedFetchCount_++;
+}
+
+void FetchMetrics::addStageTime(FetchStage stage, long long nanos) {
+    stageNanos_[static_cast<size_t>(stage)] += (unsigned long long)std::max(nanos, 0LL);
+}
+
+void FetchMetrics::merge(const FetchMetrics& other) {
+    fetchCount_ += other.fetchCount_;
+    keyCount_ += other.keyCount_;
+    roundTripCount_ += other.roundTripCount_;
+    sliceCount_ += other.sliceCount_;
+    maxSliceKeys_ = std::max(maxSliceKeys_, other.maxSliceKeys_);
+    for (size_t i = 0; i < kSliceSizeBuckets; i++) {
+        bucketSliceCounts_[i] += other.bucketSliceCounts_[i];
+        bucketKeyCounts_[i] += other.bucketKeyCounts_[i];
+        bucketLatencyMicro_[i] += other.bucketLatencyMicro_[i];
+        bucketMaxLatencyMicro_[i] = std::max(bucketMaxLatencyMicro_[i], other.bucketMaxLatencyMicro_[i]);
+    }
+    stageTimedFetchCount_ += other.stageTimedFetchCount_;
+    for (size_t i = 0; i < kFetchStageCount; i++) {
+        stageNanos_[i] += other.stageNanos_[i];
+    }
+}
+
+void FetchMetrics::reset() {
+    *this = FetchMetrics();
+}
+
+std::string FetchMetrics::toString(const std::string& indent) const {
+    std::stringstream sstream;
+    if (fetchCount_ == 0) {
+        return sstream.str();
+    }
+
+    sstream << indent << "MGET slices per fetch: " << std::to_string((double)sliceCount_ / (double)fetchCount_) << std::endl;
+    sstream << indent << "Round trips per fetch: " << std::to_string((double)roundTripCount_ / (double)fetchCount_) << std::endl;
+    sstream << indent << "Keys per fetch: " << std::to_string((double)keyCount_ / (double)fetchCount_) << std::endl;
+    if (sliceCount_ > 0) {
+        unsigned long long sliceKeyCount = std::accumulate(bucketKeyCounts_.begin(), bucketKeyCounts_.end(), 0ULL);
+        sstream << indent << "Keys per MGET slice: " << std::to_string((double)sliceKeyCount / (double)sliceCount_)
+                << " (max " << std::to_string(maxSliceKeys_) << ")" << std::endl;
+    }
+    for (size_t i = 0; i < kSliceSizeBuckets; i++) {
+        if (bucketSliceCounts_[i] == 0) {
+            continue;
+        }
+        std::string range = std::to_string(1ULL << i) + ((i + 1 < kSliceSizeBuckets) ? "-" + std::to_string((2ULL << i) - 1) : "+");
+        sstream << indent << "  slice keys " << range << ": " << std::to_string(bucketSliceCounts_[i]) << " slices, mean latency "
+                << std::to_string(bucketLatencyMicro_[i] / bucketSliceCounts_[i]) << " us, max latency "
+                << std::to_string(bucketMaxLatencyMicro_[i]) << " us, mean latency per key "
+                << std::to_string((double)bucketLatencyMicro_[i] / (double)bucketKeyCounts_[i]) << " us" << std::endl;
+    }
+
+    unsigned long long stageNanosTotal = std::accumulate(stageNanos_.begin(), stageNanos_.end(), 0ULL);
+    if ((stageTimedFetchCount_ > 0) && (stageNanosTotal > 0)) {
+        sstream << indent << "Fetch stages, mean per fetch and share of fetch time:" << std::endl;
+        for (size_t i = 0; i < kFetchStageCount; i++) {
+            sstream << indent << "  " << fetchStageToString(static_cast<FetchStage>(i)) << ": "
+                    << std::to_string((double)stageNanos_[i] / 1000.0 / (double)stageTimedFetchCount_) << " us, "
+                    << std::to_string((double)stageNanos_[i] * 100.0 / (double)stageNanosTotal) << "%" << std::endl;
+        }
+        // Everything but the wait for replies is spent in the client
+        unsigned long long waitNanos = stageNanos_[static_cast<size_t>(FetchStage::wait)];
+        sstream << indent << "  client overhead: " << std::to_string((double)(stageNanosTotal - waitNanos) * 100.0 / (double)stageNanosTotal)
+                << "%" << std::endl;
+    }
+    return sstream.str();
+}
+
+FetchMetrics& getThreadFetchMetrics() {
+    static thread_local FetchMetrics fetchMetrics;
+    return fetchMetrics;
+}
+
+FetchStageClock& getThreadFetchStageClock() {
+    static thread_local FetchStageClock fetchStageClock;
+    return fetchStageClock;
+}
+
+}  // namespace redis_store
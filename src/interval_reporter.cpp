@@ -0,0 +1,157 @@
+#include <json/json.h>
+#include <redis_workload/interval_reporter.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace query_runner {
+
+IntervalRecorder::IntervalRecorder() : active_(&intervals_[0]) {}
+
+void IntervalRecorder::recordQuery(long long latencyMicro, size_t keys, size_t bytes, bool success) {
+    int64_t criticalValue = phaser_.writerCriticalSectionEnter();
+    interval_t* active = active_.load(std::memory_order_acquire);
+    active->queryTimesMicro.recordValue(latencyMicro);
+    active->counts.queries++;
+    active->counts.keys += keys;
+    active->counts.bytes += bytes;
+    if (!success) {
+        active->counts.errors++;
+    }
+    phaser_.writerCriticalSectionExit(criticalValue);
+}
+
+void IntervalRecorder::sampleInterval(redis_store::LatencyHistogram& queryTimes, interval_counts_t& counts) {
+    std::lock_guard<std::mutex> lock(phaser_.readerLock());
+
+    // The inactive buffer was cleared by the previous sample
+    interval_t* previous = active_.load();
+    active_.store((previous == &intervals_[0]) ? &intervals_[1] : &intervals_[0], std::memory_order_release);
+    phaser_.flipPhase();
+
+    queryTimes.merge(previous->queryTimesMicro);
+    counts.queries += previous->counts.queries;
+    counts.keys += previous->counts.keys;
+    counts.bytes += previous->counts.bytes;
+    counts.errors += previous->counts.errors;
+
+    previous->queryTimesMicro.reset();
+    previous->counts = interval_counts_t();
+}
+
+IntervalReporter::IntervalReporter(const std::string& runName,
+                                   std::vector<std::shared_ptr<IntervalRecorder>> recorders,
+                                   std::chrono::milliseconds interval,
+                                   const std::string& outputFile) :
+    runName_(runName),
+    recorders_(std::move(recorders)),
+    interval_(interval) {
+    if (outputFile.empty()) {
+        return;
+    }
+
+    jsonOutput_ = outputFile.ends_with(".json");
+    output_.open(outputFile, std::ios::app);
+    if (!output_) {
+        throw std::runtime_error("Could not open interval output file: " + outputFile);
+    }
+    if (!jsonOutput_ && (output_.tellp() == 0)) {
+        output_ << "run,elapsed_seconds,queries,queries_per_second,keys_per_second,bytes_per_second,errors,p50_us,p99_us,max_us" << std::endl;
+    }
+}
+
+IntervalReporter::~IntervalReporter() {
+    stop();
+}
+
+void IntervalReporter::start() {
+    startTime_ = std::chrono::steady_clock::now();
+    lastSampleTime_ = startTime_;
+    thread_ = boost::thread(&IntervalReporter::run, this);
+}
+
+void IntervalReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        if (stopping_ || !thread_.joinable()) {
+            return;
+        }
+        stopping_ = true;
+    }
+    stopCondition_.notify_all();
+    thread_.join();
+}
+
+void IntervalReporter::run() {
+    auto nextReport = startTime_ + interval_;
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    while (!stopCondition_.wait_until(lock, nextReport, [this]() { return stopping_; })) {
+        lock.unlock();
+        report();
+        lock.lock();
+        nextReport += interval_;
+    }
+    lock.unlock();
+
+    // The queries since the last full interval
+    report();
+}
+
+void IntervalReporter::report() {
+    redis_store::LatencyHistogram queryTimes;
+    interval_counts_t counts;
+    for (auto& recorder : recorders_) {
+        recorder->sampleInterval(queryTimes, counts);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - lastSampleTime_).count();
+    double elapsedSeconds = std::chrono::duration<double>(now - startTime_).count();
+    lastSampleTime_ = now;
+    if (seconds <= 0.0) {
+        return;
+    }
+
+    double queriesPerSecond = (double)counts.queries / seconds;
+    double keysPerSecond = (double)counts.keys / seconds;
+    double bytesPerSecond = (double)counts.bytes / seconds;
+    int64_t p50 = queryTimes.getValueAtPercentile(50);
+    int64_t p99 = queryTimes.getValueAtPercentile(99);
+    int64_t max = queryTimes.getMaxValue();
+
+    std::cout << "interval " << runName_ << " " << std::to_string(elapsedSeconds) << "s: " << std::to_string(queriesPerSecond) << " queries/s, "
+              << std::to_string(keysPerSecond) << " keys/s, " << std::to_string(bytesPerSecond) << " bytes/s, " << std::to_string(counts.errors)
+              << " errors, p50 " << std::to_string(p50) << " us, p99 " << std::to_string(p99) << " us, max " << std::to_string(max) << " us"
+              << std::endl;
+
+    if (!output_.is_open()) {
+        return;
+    }
+    if (jsonOutput_) {
+        Json::Value row;
+        row["run"] = runName_;
+        row["elapsed_seconds"] = elapsedSeconds;
+        row["queries"] = (Json::UInt64)counts.queries;
+        row["queries_per_second"] = queriesPerSecond;
+        row["keys_per_second"] = keysPerSecond;
+        row["bytes_per_second"] = bytesPerSecond;
+        row["errors"] = (Json::UInt64)counts.errors;
+        row["p50_us"] = (Json::Int64)p50;
+        row["p99_us"] = (Json::Int64)p99;
+        row["max_us"] = (Json::Int64)max;
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        output_ << Json::writeString(builder, row) << std::endl;
+    }
+    else {
+        output_ << runName_ << "," << std::to_string(elapsedSeconds) << "," << std::to_string(counts.queries) << ","
+                << std::to_string(queriesPerSecond) << "," << std::to_string(keysPerSecond) << "," << std::to_string(bytesPerSecond) << ","
+                << std::to_string(counts.errors) << "," << std::to_string(p50) << "," << std::to_string(p99) << "," << std::to_string(max)
+                << std::endl;
+    }
+}
+
+}  // namespace query_runner
@@ -0,0 +1,213 @@
+#include <redis_workload/latency_histogram.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace redis_store {
+
+static const char* kSerializedHistogramTag = "HIST1";
+
+LatencyHistogram::LatencyHistogram(int64_t highestTrackableValue) : highestTrackableValue_(std::max<int64_t>(highestTrackableValue, 2)) {
+    // Sub-buckets needed to tell apart values that differ in the last
+    // significant digit, rounded up to a power of two
+    int64_t largestValueWithSingleUnitResolution = 2 * (int64_t)std::pow(10, kSignificantDigits);
+    int subBucketCountMagnitude = std::bit_width((uint64_t)largestValueWithSingleUnitResolution - 1);
+    subBucketHalfCountMagnitude_ = subBucketCountMagnitude - 1;
+    subBucketHalfCount_ = 1LL << subBucketHalfCountMagnitude_;
+    int64_t subBucketCount = 1LL << subBucketCountMagnitude;
+    subBucketMask_ = subBucketCount - 1;
+
+    // Each bucket doubles the range covered by the one before it
+    int64_t smallestUntrackableValue = subBucketCount;
+    size_t bucketCount = 1;
+    while (smallestUntrackableValue <= highestTrackableValue_) {
+        if (smallestUntrackableValue > INT64_MAX / 2) {
+            bucketCount++;
+            break;
+        }
+        smallestUntrackableValue <<= 1;
+        bucketCount++;
+    }
+    counts_.resize((bucketCount + 1) * subBucketHalfCount_);
+}
+
+size_t LatencyHistogram::getCountsIndex(int64_t value) const {
+    // The bucket is the power of two range above the first sub-bucket range
+    int bucketIndex = (64 - std::countl_zero((uint64_t)(value | subBucketMask_))) - (subBucketHalfCountMagnitude_ + 1);
+    int64_t subBucketIndex = value >> bucketIndex;
+    return ((size_t)(bucketIndex + 1) << subBucketHalfCountMagnitude_) + (subBucketIndex - subBucketHalfCount_);
+}
+
+int64_t LatencyHistogram::getValueFromIndex(size_t index) const {
+    int bucketIndex = (int)(index >> subBucketHalfCountMagnitude_) - 1;
+    int64_t subBucketIndex = (int64_t)(index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount_;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+int64_t LatencyHistogram::getHighestEquivalentValue(int64_t value) const {
+    int bucketIndex = (64 - std::countl_zero((uint64_t)(value | subBucketMask_))) - (subBucketHalfCountMagnitude_ + 1);
+    int64_t lowestEquivalentValue = (value >> bucketIndex) << bucketIndex;
+    return lowestEquivalentValue + (1LL << bucketIndex) - 1;
+}
+
+void LatencyHistogram::recordValue(int64_t value) {
+    value = std::clamp<int64_t>(value, 0, highestTrackableValue_);
+
+    counts_[getCountsIndex(value)]++;
+    totalCount_++;
+    minValue_ = std::min(minValue_, value);
+    maxValue_ = std::max(maxValue_, value);
+    valueSum_ += value;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.highestTrackableValue_ != highestTrackableValue_) {
+        throw std::invalid_argument("Cannot merge histograms with different highest trackable values");
+    }
+    for (size_t i = 0; i < counts_.size(); i++) {
+        counts_[i] += other.counts_[i];
+    }
+    totalCount_ += other.totalCount_;
+    minValue_ = std::min(minValue_, other.minValue_);
+    maxValue_ = std::max(maxValue_, other.maxValue_);
+    valueSum_ += other.valueSum_;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    totalCount_ = 0;
+    minValue_ = INT64_MAX;
+    maxValue_ = 0;
+    valueSum_ = 0;
+}
+
+double LatencyHistogram::getMean() const {
+    if (totalCount_ == 0) {
+        return 0.0;
+    }
+    return (double)(valueSum_ / totalCount_);
+}
+
+int64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+    if (totalCount_ == 0) {
+        return 0;
+    }
+    if (percentile >= 100.0) {
+        return maxValue_;
+    }
+
+    auto countAtPercentile = (uint64_t)std::ceil((std::max(percentile, 0.0) / 100.0) * (double)totalCount_);
+    countAtPercentile = std::max<uint64_t>(countAtPercentile, 1);
+
+    uint64_t runningCount = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+        runningCount += counts_[i];
+        if (runningCount >= countAtPercentile) {
+            // Never report more than was actually recorded
+            return std::min(getHighestEquivalentValue(getValueFromIndex(i)), maxValue_);
+        }
+    }
+    return maxValue_;
+}
+
+size_t LatencyHistogram::getMemoryUsage() const {
+    return counts_.capacity() * sizeof(uint64_t);
+}
+
+std::string LatencyHistogram::serialize() const {
+    std::stringstream sstream;
+    sstream << kSerializedHistogramTag << " " << highestTrackableValue_ << " " << totalCount_ << " " << getMinValue() << " " << maxValue_ << " "
+            << std::to_string((double)valueSum_);
+    for (size_t i = 0; i < counts_.size(); i++) {
+        if (counts_[i] != 0) {
+            sstream << " " << i << ":" << counts_[i];
+        }
+    }
+    return sstream.str();
+}
+
+LatencyHistogram LatencyHistogram::deserialize(std::string_view text) {
+    std::stringstream sstream {std::string(text)};
+
+    std::string tag;
+    int64_t highestTrackableValue = 0;
+    uint64_t totalCount = 0;
+    int64_t minValue = 0;
+    int64_t maxValue = 0;
+    double valueSum = 0;
+    sstream >> tag >> highestTrackableValue >> totalCount >> minValue >> maxValue >> valueSum;
+    if (!sstream || (tag != kSerializedHistogramTag)) {
+        throw std::runtime_error("Invalid serialized histogram");
+    }
+
+    LatencyHistogram histogram(highestTrackableValue);
+    uint64_t countSum = 0;
+    std::string entry;
+    while (sstream >> entry) {
+        size_t colon = entry.find(':');
+        size_t index = 0;
+        uint64_t count = 0;
+        try {
+            index = std::stoull(entry.substr(0, colon));
+            count = std::stoull(entry.substr(colon + 1));
+        }
+        catch (std::logic_error& e) {
+            throw std::runtime_error("Invalid serialized histogram count: " + entry);
+        }
+        if ((colon == std::string::npos) || (index >= histogram.counts_.size())) {
+            throw std::runtime_error("Invalid serialized histogram count: " + entry);
+        }
+        histogram.counts_[index] += count;
+        countSum += count;
+    }
+    if (countSum != totalCount) {
+        throw std::runtime_error("Invalid serialized histogram: counts do not add up to the total");
+    }
+
+    histogram.totalCount_ = totalCount;
+    histogram.minValue_ = (totalCount == 0) ? INT64_MAX : minValue;
+    histogram.maxValue_ = maxValue;
+    histogram.valueSum_ = valueSum;
+    return histogram;
+}
+
+static const double kReportPercentiles[] = {50, 90, 95, 99, 99.9, 100};
+
+static std::string percentileName(double percentile) {
+    std::stringstream sstream;
+    sstream << "p" << percentile;
+    return sstream.str();
+}
+
+std::string LatencyHistogram::toString(const std::string& indent, const std::string& name) const {
+    std::stringstream sstream;
+    for (double p : kReportPercentiles) {
+        std::stringstream percentile;
+        percentile << ((p < 100) ? " p" : "p") << p;
+        sstream << indent << name << " elapsed(microseconds) " << percentile.str() << ": " << std::to_string(getValueAtPercentile(p)) << std::endl;
+    }
+    return sstream.str();
+}
+
+Json::Value LatencyHistogram::toJson() const {
+    Json::Value json;
+    json["count"] = (Json::UInt64)totalCount_;
+    json["mean_us"] = getMean();
+    json["min_us"] = (Json::Int64)getMinValue();
+    json["max_us"] = (Json::Int64)maxValue_;
+    for (double p : kReportPercentiles) {
+        json[percentileName(p) + "_us"] = (Json::Int64)getValueAtPercentile(p);
+    }
+    json["histogram"] = serialize();
+    return json;
+}
+
+}  // namespace redis_store
@@ -0,0 +1,82 @@
+#include <fcntl.h>
+#include <redis_workload/mapped_file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace query_runner {
+
+MappedFile::MappedFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    // The mapping holds its own reference to the file
+    try {
+        map(fd, filename);
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+MappedFile::MappedFile(int fd, const std::string& name) {
+    map(fd, name);
+}
+
+void MappedFile::map(int fd, const std::string& name) {
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0) {
+        throw std::runtime_error("Could not stat file: " + name);
+    }
+
+    size_ = static_cast<size_t>(fileStat.st_size);
+    if (size_ == 0) {
+        // mmap rejects zero length mappings, an empty file is an empty view
+        return;
+    }
+
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        throw std::runtime_error("Could not map file: " + name);
+    }
+
+    // Workload files are read in full, so start readahead of the whole file
+    madvise(mapping, size_, MADV_WILLNEED);
+    data_ = static_cast<const char*>(mapping);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+}  // namespace query_runner
@@ -1,28 +1,100 @@
+#include <redis_workload/allocation_counter.h>
+#include <redis_workload/cpu_affinity.h>
+#include <redis_workload/mapped_file.h>
 #include <redis_workload/query_runner.h>
 #include <redis_workload/util.h>
 
+#include <algorithm>
 #include <boost/chrono.hpp>
-#include <fstream>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
-using redis_store::findPercentile;
 using redis_store::multiget_result_map_t;
 using redis_store::RedisDataStore;
 using redis_store::vector_keys_t;
 
 namespace query_runner {
 
-inline vector_keys_t parseLine(std::string& line) {
-    vector_keys_t keyList;
+ResultApi resultApiFromString(const std::string& name) {
+    if (name == "map") {
+        return ResultApi::map;
+    }
+    if (name == "vector") {
+        return ResultApi::vector;
+    }
+    throw std::runtime_error("Unknown result API: " + name);
+}
+
+std::string resultApiToString(ResultApi resultApi) {
+    switch (resultApi) {
+        case ResultApi::map:
+            return "map";
+        case ResultApi::vector:
+            return "vector";
+    }
+    return "unknown";
+}
+
+/**
+ * Split a CSV line into key views without copying the key bytes.
+ * Empty fields are kept, matching the previous getline based parser.
+ *
+ * @param line the CSV line without its newline
+ * @param keyList the key views are appended here
+ *
+ * @return the number of keys found on the line
+ */
+inline uint32_t parseLine(std::string_view line, vector_key_views_t& keyList) {
+    uint32_t keyCount = 1;
+
+    const char* pos = line.data();
+    const char* end = pos + line.size();
+    while (true) {
+        const char* comma = static_cast<const char*>(memchr(pos, ',', end - pos));
+        if (comma == nullptr) {
+            keyList.emplace_back(pos, end - pos);
+            break;
+        }
+        keyList.emplace_back(pos, comma - pos);
+        pos = comma + 1;
+        keyCount++;
+    }
+    return keyCount;
+}
+
+int64_t parseQueryTime(std::string_view field) {
+    static const int kMicrosecondDigits = 6;
+
+    size_t point = field.find('.');
+    std::string_view seconds = field.substr(0, point);
+    std::string_view fraction = (point == std::string_view::npos) ? std::string_view() : field.substr(point + 1);
 
-    std::stringstream ss(line);
-    while (ss.good()) {
-        std::string k;
-        getline(ss, k, ',');
-        keyList.push_back(k);
+    int64_t wholeSeconds = 0;
+    auto [secondsEnd, secondsError] = std::from_chars(seconds.data(), seconds.data() + seconds.size(), wholeSeconds);
+    if (seconds.empty() || (secondsError != std::errc()) || (secondsEnd != seconds.data() + seconds.size()) || (wholeSeconds < 0)) {
+        throw std::runtime_error("Invalid query time: " + std::string(field));
     }
-    return keyList;
+
+    int64_t micros = 0;
+    for (int digit = 0; digit < kMicrosecondDigits; digit++) {
+        micros *= 10;
+        if (static_cast<size_t>(digit) < fraction.size()) {
+            if ((fraction[digit] < '0') || (fraction[digit] > '9')) {
+                throw std::runtime_error("Invalid query time: " + std::string(field));
+            }
+            micros += fraction[digit] - '0';
+        }
+    }
+    return (wholeSeconds * 1000000) + micros;
 }
 
 inline boost::chrono::high_resolution_clock::time_point createTimer() {
@@ -34,62 +106,322 @@ inline long long readTimerMicroseconds(boost::chrono::high_resolution_clock::tim
     return duration.count();
 }
 
-QueryListCollector::QueryListCollector(unsigned int bucketCount, OperationMode mode) : bucketCount_(bucketCount), mode_(mode) {
-    initializeBuckets();
+QueryDispatcher::QueryDispatcher(size_t queryCount, size_t chunkSize, bool cycle) :
+    queryCount_(queryCount),
+    chunkSize_(std::max<size_t>(chunkSize, 1)),
+    cycle_(cycle) {}
+
+bool QueryDispatcher::claim(size_t& begin, size_t& end) {
+    // Claims past the end leave the cursor beyond queryCount_, so it must
+    // not be compared for equality
+    size_t first = nextQuery_.fetch_add(chunkSize_, std::memory_order_relaxed);
+    if (cycle_ && (queryCount_ > 0)) {
+        // The last chunk of a pass is short unless the chunk size divides
+        // the query count
+        first %= queryCount_;
+    }
+    if (first >= queryCount_) {
+        return false;
+    }
+    begin = first;
+    end = std::min(first + chunkSize_, queryCount_);
+    return true;
+}
+
+size_t QueryDispatcher::getChunkSize() const {
+    return chunkSize_;
 }
 
-void QueryListCollector::initializeBuckets() {
-    queryBuckets_ = std::unordered_map<unsigned int, std::vector<vector_keys_t>>();
-    queryBuckets_.reserve(bucketCount_);
-    for (unsigned int i = 0; i < bucketCount_; i++) {
-        queryBuckets_[i] = std::vector<vector_keys_t>();
-    }
+QueryCursor::QueryCursor(size_t first, size_t end, size_t stride) :
+    first_(first),
+    next_(first),
+    end_(end),
+    stride_(std::max<size_t>(stride, 1)) {}
+
+QueryCursor::QueryCursor(QueryDispatcher& dispatcher) :
+    dispatcher_(&dispatcher),
+    first_(0),
+    next_(0),
+    end_(0),
+    stride_(1) {}
+
+void QueryCursor::cycleUntil(std::chrono::steady_clock::time_point deadline) {
+    cycling_ = true;
+    deadline_ = deadline;
+}
+
+void QueryCursor::setQueryLimit(size_t queryLimit) {
+    cycling_ = true;
+    remaining_ = queryLimit;
 }
 
-void QueryListCollector::parseCsvIntoBuckets(const std::string& filename) {
-    std::ifstream csvFile(filename);
-    if (!csvFile.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+bool QueryCursor::next(size_t& query) {
+    if (remaining_ == 0) {
+        return false;
+    }
+    if ((deadline_ != std::chrono::steady_clock::time_point::max()) && (std::chrono::steady_clock::now() >= deadline_)) {
+        return false;
+    }
+    if (next_ >= end_) {
+        if (dispatcher_ != nullptr) {
+            if (!dispatcher_->claim(next_, end_)) {
+                return false;
+            }
+        }
+        else if (cycling_ && (first_ < end_)) {
+            next_ = first_;
+        }
+        else {
+            return false;
+        }
     }
+    query = next_;
+    next_ += stride_;
+    remaining_--;
+    return true;
+}
+
+StartGate::StartGate(unsigned int runnerCount) :
+    runnerCount_(runnerCount) {}
+
+std::chrono::steady_clock::time_point StartGate::arriveAndWait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    arrived_++;
+    condition_.notify_all();
+    condition_.wait(lock, [this]() {
+        return released_;
+    });
+    return startTime_;
+}
+
+void StartGate::waitForRunners() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() {
+        return arrived_ >= runnerCount_;
+    });
+}
+
+std::chrono::steady_clock::time_point StartGate::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    startTime_ = std::chrono::steady_clock::now();
+    released_ = true;
+    condition_.notify_all();
+    return startTime_;
+}
+
+QueryListCollector::QueryListCollector(unsigned int bucketCount, OperationMode mode) :
+    workload_(QueryWorkloadBuilder().build()),
+    bucketCount_(bucketCount),
+    mode_(mode) {}
+
+void QueryListCollector::setCsvQueryTimes(bool queryTimes) {
+    csvQueryTimes_ = queryTimes;
+}
+
+/**
+ * Parse all non-empty lines in a newline aligned region of the CSV file.
+ *
+ * @param chunk the region of the mapped file to parse
+ * @param queryTimes true if the first field of each line is the query time
+ *
+ * @throws std::runtime_error if a query time is invalid.
+ * @return the keys of the queries found in the chunk, in file order.
+ */
+ParsedCsvChunk QueryListCollector::parseCsvChunk(std::string_view chunk, bool queryTimes) {
+    ParsedCsvChunk queries;
+
+    const char* pos = chunk.data();
+    const char* end = pos + chunk.size();
+    while (pos < end) {
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        const char* lineEnd = (newline != nullptr) ? newline : end;
+        std::string_view line(pos, lineEnd - pos);
+        pos = lineEnd + 1;
 
-    std::string line;
-    unsigned long long lineCounter = 0;
-    while (std::getline(csvFile, line)) {
         if (line.empty()) {
             continue;
         }
+        if (queryTimes) {
+            size_t comma = line.find(',');
+            if (comma == std::string_view::npos) {
+                throw std::runtime_error("Query without keys after its time: " + std::string(line));
+            }
+            queries.queryTimes.push_back(parseQueryTime(line.substr(0, comma)));
+            line.remove_prefix(comma + 1);
+        }
+        queries.queryKeyCounts.push_back(parseLine(line, queries.keys));
+    }
+    return queries;
+}
+
+/**
+ * Divide the data into chunkCount regions of roughly equal size. Each
+ * boundary is moved forward to the start of the next line so no line
+ * is split across chunks.
+ */
+std::vector<std::string_view> QueryListCollector::splitIntoChunks(std::string_view data, unsigned int chunkCount) {
+    std::vector<std::string_view> chunks;
+    chunks.reserve(chunkCount);
+
+    size_t chunkStart = 0;
+    for (unsigned int i = 1; i <= chunkCount && chunkStart < data.size(); i++) {
+        size_t chunkEnd = data.size();
+        if (i < chunkCount) {
+            chunkEnd = std::max(chunkStart, data.size() / chunkCount * i);
+            size_t newline = data.find('\n', chunkEnd);
+            chunkEnd = (newline == std::string_view::npos) ? data.size() : newline + 1;
+        }
+        chunks.push_back(data.substr(chunkStart, chunkEnd - chunkStart));
+        chunkStart = chunkEnd;
+    }
+    return chunks;
+}
 
-        vector_keys_t keyList = parseLine(line);
-        unsigned int bucket = lineCounter % bucketCount_;
-        switch (mode_) {
-            case OperationMode::divide:
-                // Divide the queries across the buckets
-                queryBuckets_[bucket].push_back(keyList);
-                break;
-            case OperationMode::replicate:
-                // Push the query into all buckets
-                for (auto& i : queryBuckets_) {
-                    i.second.push_back(keyList);
-                }
-                break;
+std::shared_ptr<const QueryWorkload> QueryListCollector::parseCsvWorkload(const std::string& filename, unsigned int parseThreadCount, bool queryTimes) {
+    // The mapping only has to live until the keys are copied into the workload arena
+    MappedFile csvFile(filename);
+
+    std::vector<std::string_view> chunks = splitIntoChunks(csvFile.view(), std::max(1U, parseThreadCount));
+    std::vector<ParsedCsvChunk> parsedChunks(chunks.size());
+    std::vector<std::exception_ptr> parseErrors(chunks.size());
+
+    std::vector<boost::thread> parsers;
+    parsers.reserve(chunks.size());
+    for (size_t c = 0; c < chunks.size(); c++) {
+        parsers.emplace_back([&chunks, &parsedChunks, &parseErrors, queryTimes, c]() {
+            try {
+                parsedChunks[c] = parseCsvChunk(chunks[c], queryTimes);
+            }
+            catch (...) {
+                parseErrors[c] = std::current_exception();
+            }
+        });
+    }
+    for (auto& t : parsers) {
+        t.join();
+    }
+    for (auto& error : parseErrors) {
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Chunks are interned in file order, so query i is the i-th non-empty line
+    QueryWorkloadBuilder builder;
+    for (auto& chunk : parsedChunks) {
+        size_t keyPos = 0;
+        for (size_t q = 0; q < chunk.queryKeyCounts.size(); q++) {
+            std::span<const std::string_view> keys(chunk.keys.data() + keyPos, chunk.queryKeyCounts[q]);
+            if (queryTimes) {
+                builder.addQuery(keys, chunk.queryTimes[q]);
+            }
+            else {
+                builder.addQuery(keys);
+            }
+            keyPos += keys.size();
         }
-        lineCounter++;
+        chunk = ParsedCsvChunk();
+    }
+    return builder.build();
+}
+
+std::shared_ptr<const QueryWorkload> QueryListCollector::loadWorkload(const std::string& filename, unsigned int parseThreadCount, bool queryTimes) {
+    if (QueryWorkload::isBinaryFile(filename)) {
+        return QueryWorkload::loadBinaryFile(filename);
+    }
+    return parseCsvWorkload(filename, parseThreadCount, queryTimes);
+}
+
+void QueryListCollector::parseCsvIntoBuckets(const std::string& filename, unsigned int parseThreadCount) {
+    workload_ = parseCsvWorkload(filename, parseThreadCount, csvQueryTimes_);
+
+    printWorkloadSummary();
+}
+
+void QueryListCollector::loadBinaryIntoBuckets(const std::string& filename) {
+    workload_ = QueryWorkload::loadBinaryFile(filename);
+
+    printWorkloadSummary();
+}
+
+void QueryListCollector::loadIntoBuckets(const std::string& filename, unsigned int parseThreadCount) {
+    workload_ = loadWorkload(filename, parseThreadCount, csvQueryTimes_);
+
+    printWorkloadSummary();
+}
+
+void QueryListCollector::loadSharedIntoBuckets(const std::string& filename, const std::string& sharedMemoryName, unsigned int parseThreadCount) {
+    WorkloadSource source = WorkloadSource::fromFile(filename, csvQueryTimes_);
+    workload_ = QueryWorkload::openSharedMemory(sharedMemoryName, source, [&filename, parseThreadCount, this]() {
+        return loadWorkload(filename, parseThreadCount, csvQueryTimes_);
+    });
+
+    printWorkloadSummary();
+}
+
+void QueryListCollector::setProcessSlice(unsigned int processIndex, unsigned int processCount) {
+    if ((processCount == 0) || (processIndex >= processCount)) {
+        throw std::invalid_argument("process index must be less than the process count");
+    }
+    processIndex_ = processIndex;
+    processCount_ = processCount;
+}
+
+void QueryListCollector::setBucketCount(unsigned int bucketCount) {
+    if (bucketCount == 0) {
+        throw std::invalid_argument("bucket count must be at least 1");
     }
+    bucketCount_ = bucketCount;
+}
 
+void QueryListCollector::printWorkloadSummary() {
+    std::cout << "After parse, workload: " << std::to_string(workload_->getQueryCount()) << " queries, "
+              << std::to_string(workload_->getKeyCount()) << " distinct keys, " << std::to_string(workload_->getMemoryUsage())
+              << " bytes" << std::endl;
+    if (workload_->hasQueryTimes() && (workload_->getQueryCount() > 0)) {
+        int64_t lastQueryTime = workload_->getFirstQueryTime();
+        for (size_t q = 0; q < workload_->getQueryCount(); q++) {
+            lastQueryTime = std::max(lastQueryTime, workload_->getQueryTime(q));
+        }
+        std::cout << "After parse, query times span: " << std::to_string((lastQueryTime - workload_->getFirstQueryTime()) / 1000)
+                  << " milliseconds" << std::endl;
+    }
+    if (processCount_ > 1) {
+        std::cout << "After parse, process slice: " << std::to_string(processIndex_) << " of " << std::to_string(processCount_) << std::endl;
+    }
+    if (mode_ == OperationMode::dynamic) {
+        std::cout << "After parse, shared bucket size: " << std::to_string(getBucket(0).size()) << std::endl;
+        return;
+    }
     std::cout << "After parse, bucket sizes: " << std::endl;
     for (unsigned int i = 0; i < bucketCount_; i++) {
-        // std::cout << "bucket: " << std::to_string(i) << "  -- " <<
-        // std::to_string(queryBuckets_[i].size()) << "  " << queryBuckets_[i][0][0]
-        // << std::endl;
-        std::cout << "    bucket: " << std::to_string(i) << "  -- " << std::to_string(queryBuckets_[i].size()) << std::endl;
+        std::cout << "    bucket: " << std::to_string(i) << "  -- " << std::to_string(getBucket(i).size()) << std::endl;
     }
 }
 
-std::vector<vector_keys_t> QueryListCollector::getBucket(unsigned int bucketId) {
-    return queryBuckets_[bucketId];
+QueryBucket QueryListCollector::getBucket(unsigned int bucketId) {
+    // This process owns queries processIndex_, processIndex_ + processCount_, ...
+    switch (mode_) {
+        case OperationMode::divide:
+            // Divide the process slice across the buckets
+            return {workload_, processIndex_ + (static_cast<size_t>(bucketId) * processCount_), static_cast<size_t>(processCount_) * bucketCount_};
+        case OperationMode::replicate:
+        case OperationMode::dynamic:
+            // Every bucket sees the whole process slice
+            return {workload_, processIndex_, processCount_};
+    }
+    return {};
+}
+
+OperationMode QueryListCollector::getMode() {
+    return mode_;
 }
 
-QueryRunner::QueryRunner(std::string& name, unsigned int id, const std::shared_ptr<RedisDataStore>& dataStore, std::vector<vector_keys_t> queryList) :
+std::shared_ptr<const QueryWorkload> QueryListCollector::getWorkload() {
+    return workload_;
+}
+
+QueryRunner::QueryRunner(std::string& name, unsigned int id, const std::shared_ptr<RedisDataStore>& dataStore, QueryBucket queryList) :
     id_(id),
     dataStore_(dataStore) {
     setName(name);
@@ -99,8 +431,8 @@ QueryRunner::QueryRunner(std::string& name, unsigned int id, const std::shared_p
 size_t QueryRunner::getMaxKeyLength() {
     size_t maxLength = 0;
 
-    for (auto& q : queryList_) {
-        size_t currLength = q.size();
+    for (size_t i = 0; i < queryList_.size(); i++) {
+        size_t currLength = queryList_.getQuery(i).size();
         if (currLength > maxLength) {
             maxLength = currLength;
         }
@@ -123,14 +455,72 @@ size_t QueryRunner::getQueryCount() {
 size_t QueryRunner::getQueryListKeysTotal() {
     size_t total = 0;
 
-    for (auto& q : queryList_) {
-        total += q.size();
+    for (size_t i = 0; i < queryList_.size(); i++) {
+        total += queryList_.getQuery(i).size();
     }
 
     return total;
 }
 
-void QueryRunner::setQueryList(std::vector<vector_keys_t>& queryList) {
+void QueryRunner::setResultApi(ResultApi resultApi) {
+    resultApi_ = resultApi;
+}
+
+void QueryRunner::setOpenLoop(double ratePerSecond, ArrivalDistribution distribution, unsigned int runnerIndex, unsigned int runnerCount) {
+    openLoopRate_ = ratePerSecond;
+    arrivalDistribution_ = distribution;
+    openLoopRunnerCount_ = std::max(runnerCount, 1U);
+    openLoopRunnerIndex_ = runnerIndex % openLoopRunnerCount_;
+}
+
+void QueryRunner::setReplay(double speedup) {
+    replaySpeedup_ = speedup;
+}
+
+void QueryRunner::setMaxInflight(unsigned int maxInflight) {
+    maxInflight_ = maxInflight;
+}
+
+void QueryRunner::setVirtualClients(unsigned int virtualClients, const std::shared_ptr<CoroutineExecutor>& executor) {
+    virtualClients_ = virtualClients;
+    executor_ = executor;
+}
+
+void QueryRunner::setDispatcher(const std::shared_ptr<QueryDispatcher>& dispatcher) {
+    dispatcher_ = dispatcher;
+}
+
+void QueryRunner::setStartGate(const std::shared_ptr<StartGate>& startGate) {
+    startGate_ = startGate;
+}
+
+void QueryRunner::setDuration(std::chrono::milliseconds duration) {
+    runDuration_ = duration;
+}
+
+void QueryRunner::setQueryLimit(size_t queryLimit) {
+    queryLimit_ = queryLimit;
+}
+
+void QueryRunner::setCpuAffinity(const std::vector<int>& cpus, bool localQueries) {
+    cpuAffinity_ = cpus;
+    localQueries_ = localQueries;
+}
+
+QueryCursor QueryRunner::makeCursor(size_t first, size_t stride) {
+    QueryCursor cursor = (dispatcher_ != nullptr) ? QueryCursor(*dispatcher_) : QueryCursor(first, queryList_.size(), stride);
+    if (runDuration_.count() > 0) {
+        cursor.cycleUntil(deadline_);
+    }
+    if (queryLimit_ > 0) {
+        // Client first of stride clients takes its share of the limit
+        size_t clients = std::max<size_t>(stride, 1);
+        cursor.setQueryLimit((queryLimit_ / clients) + ((first < queryLimit_ % clients) ? 1 : 0));
+    }
+    return cursor;
+}
+
+void QueryRunner::setQueryList(const QueryBucket& queryList) {
     queryList_ = queryList;
     queryListKeysTotal_ = getQueryListKeysTotal();
     maxKeyLength_ = getMaxKeyLength();
@@ -147,32 +537,282 @@ void QueryRunner::run() {
     unsigned long querySuccessCount = 0;
     unsigned long totalFetchedObjectCount = 0;
 
-    std::vector<long long> individualQueryTimesMicro;
-    individualQueryTimesMicro.reserve(queryList_.size());
+    if (!cpuAffinity_.empty()) {
+        try {
+            redis_store::setThreadAffinity(cpuAffinity_);
+        }
+        catch (std::runtime_error& e) {
+            std::cout << "warn: " << getName() << ": " << e.what() << std::endl;
+        }
+        // Allocated and first written after pinning, so the kernel places
+        // the per-runner data on the runner's NUMA node
+        if (localQueries_) {
+            setQueryList(queryList_.copyQueries());
+        }
+        queryTimesMicro_ = redis_store::LatencyHistogram();
+        serviceTimesMicro_ = redis_store::LatencyHistogram();
+    }
+    placementCpus_ = redis_store::getThreadAffinity();
+    placementNodes_ = redis_store::getNumaNodesOfCpus(placementCpus_);
+
+    queryTimesMicro_.reset();
+
+    // Reused for every query, keys are views into the shared workload arena
+    // with the hashslots calculated when the workload was loaded
+    redis_store::vector_hashslot_keys_t queryKeys;
+    queryKeys.reserve(maxKeyLength_);
+
+    // Reused for every query by the vector result API
+    redis_store::vector_results_t resultObjects;
+    resultObjects.reserve(maxKeyLength_);
+
+    // Spread the runners over the independent cluster clients, so their
+    // requests and replies go through different event loops
+    clusterClient_ = id_ % std::max<size_t>(dataStore_->getClientCount(), 1);
+    dataStore_->bindThreadToClient(clusterClient_);
 
     std::cout << "  " << getName() << " starting runner " << std::to_string(id_) << std::endl;
 
+    auto startTime = (startGate_ != nullptr) ? startGate_->arriveAndWait() : std::chrono::steady_clock::now();
+    deadline_ = startTime + runDuration_;
+
     auto totalTimer = createTimer();
+    unsigned long long allocationsAtStart = redis_store::getThreadAllocationCount();
+    redis_store::getThreadFetchMetrics().reset();
+
+    bool openLoop = (openLoopRate_ > 0.0) || (replaySpeedup_ > 0.0);
+    std::optional<ArrivalSchedule> schedule;
+    serviceTimesMicro_.reset();
+    maxSendLagMicro_ = 0;
+    if (openLoop && (replaySpeedup_ == 0.0)) {
+        schedule.emplace(openLoopRate_, arrivalDistribution_, openLoopRunnerIndex_ + 1, (double)openLoopRunnerIndex_ / openLoopRunnerCount_);
+    }
+    // Shared by the runners released by the same gate
+    auto scheduleStart = startTime;
+
+    // Replayed queries keep their offset from the start of the log, scaled
+    // by the speedup, so every runner reproduces its share of the original
+    // arrival pattern
+    auto scheduledSendTime = [&](size_t q) -> std::chrono::steady_clock::time_point {
+        if (replaySpeedup_ > 0.0) {
+            auto offsetMicro = (double)(queryList_.getQueryTime(q) - queryList_.getFirstQueryTime()) / replaySpeedup_;
+            return scheduleStart + std::chrono::microseconds((long long)offsetMicro);
+        }
+        return scheduleStart + schedule->next();
+    };
+
+    // Asynchronous fetches in flight, guarded by completionMutex along with
+    // the counters the completion callbacks update
+    std::mutex completionMutex;
+    std::condition_variable completionCondition;
+    size_t inflight = 0;
+
+    size_t queryCount = 0;
+    if (virtualClients_ > 0) {
+        VirtualClientState merged = runVirtualClients();
+        querySuccessCount = merged.successCount;
+        totalFetchedObjectCount = merged.fetchedObjectCount;
+        queryCount = merged.queryCount;
+    }
 
-    for (auto& k : queryList_) {
-        vector_keys_t sharedKeys = k;
-        std::shared_ptr<multiget_result_map_t> results = std::make_shared<multiget_result_map_t>();
-        // TODO add in collection of timing for each query
-        auto timer = createTimer();
-        dataStore_->fetchByFeatureKeys(sharedKeys, results, false);
-        long long runtime = readTimerMicroseconds(timer);
-        individualQueryTimesMicro.push_back(runtime);
-        querySuccessCount++;
-        totalFetchedObjectCount += results->size();
+    QueryCursor cursor = makeCursor(0, 1);
+    size_t q = 0;
+    while ((virtualClients_ == 0) && cursor.next(q)) {
+        queryCount++;
+        queryKeys.clear();
+        for (key_id_t id : queryList_.getQuery(q)) {
+            queryKeys.push_back({queryList_.getKey(id), queryList_.getHashslot(id)});
+        }
+
+        if (maxInflight_ > 0) {
+            std::chrono::steady_clock::time_point intendedSend;
+            if (openLoop) {
+                intendedSend = scheduledSendTime(q);
+                std::this_thread::sleep_until(intendedSend);
+            }
+            {
+                std::unique_lock<std::mutex> lock(completionMutex);
+                completionCondition.wait(lock, [&inflight, this]() {
+                    return inflight < maxInflight_;
+                });
+                inflight++;
+            }
+            auto actualSend = std::chrono::steady_clock::now();
+            if (!openLoop) {
+                intendedSend = actualSend;
+            }
+
+            // Runs on a redis++ event loop thread
+            size_t keyCount = queryKeys.size();
+            dataStore_->fetchByFeatureKeysAsync(queryKeys, [&, intendedSend, actualSend, keyCount](redis_store::vector_results_t& results, std::exception_ptr error) {
+                auto complete = std::chrono::steady_clock::now();
+                size_t fetchedBytes = 0;
+                size_t fetchedCount = redis_store::countFetchedObjects(results, fetchedBytes);
+
+                std::lock_guard<std::mutex> lock(completionMutex);
+                long long queryTime = std::chrono::duration_cast<std::chrono::microseconds>(complete - intendedSend).count();
+                queryTimesMicro_.recordValue(queryTime);
+                recordInterval(queryTime, keyCount, fetchedBytes, error == nullptr);
+                if (openLoop) {
+                    serviceTimesMicro_.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(complete - actualSend).count());
+                }
+                totalFetchedObjectCount += fetchedCount;
+                if (error == nullptr) {
+                    querySuccessCount++;
+                }
+                inflight--;
+                completionCondition.notify_all();
+            });
+
+            if (openLoop) {
+                maxSendLagMicro_ = std::max(maxSendLagMicro_, (long long)std::chrono::duration_cast<std::chrono::microseconds>(actualSend - intendedSend).count());
+            }
+        }
+        else if (!openLoop) {
+            auto timer = createTimer();
+            size_t fetchedBytes = 0;
+            totalFetchedObjectCount += fetchQuery(queryKeys, resultObjects, fetchedBytes);
+            long long runtime = readTimerMicroseconds(timer);
+            queryTimesMicro_.recordValue(runtime);
+            recordInterval(runtime, queryKeys.size(), fetchedBytes, true);
+            querySuccessCount++;
+        }
+        else {
+            // A query sent late because the previous one was slow is timed
+            // from when it should have been sent, which is the latency a
+            // client arriving on schedule would have seen
+            auto intendedSend = scheduledSendTime(q);
+            std::this_thread::sleep_until(intendedSend);
+            auto actualSend = std::chrono::steady_clock::now();
+            size_t fetchedBytes = 0;
+            totalFetchedObjectCount += fetchQuery(queryKeys, resultObjects, fetchedBytes);
+            auto complete = std::chrono::steady_clock::now();
+
+            long long queryTime = std::chrono::duration_cast<std::chrono::microseconds>(complete - intendedSend).count();
+            queryTimesMicro_.recordValue(queryTime);
+            recordInterval(queryTime, queryKeys.size(), fetchedBytes, true);
+            serviceTimesMicro_.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(complete - actualSend).count());
+            maxSendLagMicro_ = std::max(maxSendLagMicro_, (long long)std::chrono::duration_cast<std::chrono::microseconds>(actualSend - intendedSend).count());
+            querySuccessCount++;
+        }
+    }
+
+    // The completion callbacks update the counters, wait for the last one
+    {
+        std::unique_lock<std::mutex> lock(completionMutex);
+        completionCondition.wait(lock, [&inflight]() {
+            return inflight == 0;
+        });
     }
 
     long totalRuntimeMicroseconds = readTimerMicroseconds(totalTimer);
     long totalRuntimeMilliseconds = totalRuntimeMicroseconds / 1000;
-
-    makeReport(totalRuntimeMilliseconds, queryList_.size(), querySuccessCount, totalFetchedObjectCount, individualQueryTimesMicro);
+    allocationCount_ = redis_store::getThreadAllocationCount() - allocationsAtStart;
+    fetchMetrics_ = redis_store::getThreadFetchMetrics();
+
+    runtimeMilliseconds_ = totalRuntimeMilliseconds;
+    runQueryCount_ = queryCount;
+    querySuccessCount_ = querySuccessCount;
+    fetchedObjectCount_ = totalFetchedObjectCount;
+    makeReport(totalRuntimeMilliseconds, queryCount, querySuccessCount, totalFetchedObjectCount);
     runComplete_ = true;
 }
 
+VirtualClientTask QueryRunner::virtualClient(size_t clientId, QueryCursor cursor, VirtualClientState& state) {
+    redis_store::vector_hashslot_keys_t queryKeys;
+    queryKeys.reserve(maxKeyLength_);
+
+    size_t q = 0;
+    while (cursor.next(q)) {
+        state.queryCount++;
+        queryKeys.clear();
+        for (key_id_t id : queryList_.getQuery(q)) {
+            queryKeys.push_back({queryList_.getKey(id), queryList_.getHashslot(id)});
+        }
+
+        auto timer = createTimer();
+        FetchAwaitable fetch(*dataStore_, queryKeys, *executor_);
+        bool success = false;
+        try {
+            state.fetchedObjectCount += co_await fetch;
+            state.successCount++;
+            success = true;
+        }
+        catch (std::exception& e) {
+            std::cerr << "error: " << getName() << " virtual client " << std::to_string(clientId) << " fetch failed: " << e.what() << std::endl;
+        }
+        long long runtime = readTimerMicroseconds(timer);
+        {
+            // The clients of the runner share its histogram and interval recorder
+            std::lock_guard<std::mutex> lock(queryTimesMutex_);
+            queryTimesMicro_.recordValue(runtime);
+            recordInterval(runtime, queryKeys.size(), fetch.getFetchedBytes(), success);
+        }
+    }
+}
+
+QueryRunner::VirtualClientState QueryRunner::runVirtualClients() {
+    std::vector<VirtualClientState> clients(virtualClients_);
+
+    std::mutex completionMutex;
+    std::condition_variable completionCondition;
+    size_t remaining = clients.size();
+
+    for (size_t c = 0; c < clients.size(); c++) {
+        virtualClient(c, makeCursor(c, clients.size()), clients[c]).start(*executor_, [&, c](std::exception_ptr error) {
+            if (error != nullptr) {
+                std::cerr << "error: " << getName() << " virtual client " << std::to_string(c) << " failed" << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(completionMutex);
+            remaining--;
+            completionCondition.notify_all();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(completionMutex);
+        completionCondition.wait(lock, [&remaining]() {
+            return remaining == 0;
+        });
+    }
+
+    VirtualClientState merged;
+    for (VirtualClientState& client : clients) {
+        merged.queryCount += client.queryCount;
+        merged.successCount += client.successCount;
+        merged.fetchedObjectCount += client.fetchedObjectCount;
+    }
+    return merged;
+}
+
+size_t QueryRunner::fetchQuery(const redis_store::vector_hashslot_keys_t& queryKeys, redis_store::vector_results_t& resultObjects, size_t& fetchedBytes) {
+    fetchedBytes = 0;
+    switch (resultApi_) {
+        case ResultApi::map: {
+            std::shared_ptr<multiget_result_map_t> results = std::make_shared<multiget_result_map_t>();
+            dataStore_->fetchByFeatureKeys(queryKeys, results, false);
+            for (const auto& [key, value] : *results) {
+                fetchedBytes += value.has_value() ? value->size() : 0;
+            }
+            return results->size();
+        }
+        case ResultApi::vector:
+            dataStore_->fetchByFeatureKeys(queryKeys, resultObjects);
+            return redis_store::countFetchedObjects(resultObjects, fetchedBytes);
+    }
+    return 0;
+}
+
+void QueryRunner::setIntervalRecorder(const std::shared_ptr<IntervalRecorder>& intervalRecorder) {
+    intervalRecorder_ = intervalRecorder;
+}
+
+void QueryRunner::recordInterval(long long latencyMicro, size_t keys, size_t bytes, bool success) {
+    if (intervalRecorder_ != nullptr) {
+        intervalRecorder_->recordQuery(latencyMicro, keys, bytes, success);
+    }
+}
+
 bool QueryRunner::runComplete() {
     return runComplete_;
 }
@@ -184,28 +824,74 @@ boost::thread QueryRunner::spawn() {
 void QueryRunner::makeReport(long runtime,
                              size_t queryCount,
                              unsigned long querySuccessCount,
-                             unsigned long totalFetchedObjects,
-                             [[maybe_unused]] std::vector<long long> individualQueryTimesMicro) {
+                             unsigned long totalFetchedObjects) {
     std::stringstream sstream;
     sstream << "Runner report: " << std::to_string(id_) << std::endl;
     sstream << "  Input query count: " << std::to_string(queryCount) << std::endl;
+    if (dispatcher_ != nullptr) {
+        sstream << "  Dispatch: dynamic, " << std::to_string(queryCount) << " of " << std::to_string(queryList_.size())
+                << " shared queries in chunks of " << std::to_string(dispatcher_->getChunkSize()) << std::endl;
+    }
     sstream << "  Query successes count: " << std::to_string(querySuccessCount) << std::endl;
     sstream << "  Input qeoId count: " << std::to_string(queryListKeysTotal_) << std::endl;
     sstream << "  Max key length: " << std::to_string(maxKeyLength_) << std::endl;
     sstream << "  Fetched object count: " << std::to_string(totalFetchedObjects) << std::endl;
     sstream << "  Total runtime: " << std::to_string(runtime) << " milliseconds" << std::endl;
-
-    std::vector percentiles {50, 90, 95, 99, 100};
-    for (auto p : percentiles) {
-        std::string percentilePrefix;
-        if (p < 100) {
-            percentilePrefix = " p";
+    if (runDuration_.count() > 0) {
+        sstream << "  Duration bound: " << std::to_string(runDuration_.count()) << " milliseconds, cycling through " << std::to_string(queryList_.size())
+                << " queries" << std::endl;
+    }
+    if (queryLimit_ > 0) {
+        sstream << "  Query limit: " << std::to_string(queryLimit_) << " queries, cycling through " << std::to_string(queryList_.size()) << " queries"
+                << std::endl;
+    }
+    if (dataStore_->getClientCount() > 1) {
+        sstream << "  Cluster client: " << std::to_string(clusterClient_) << " of " << std::to_string(dataStore_->getClientCount()) << std::endl;
+    }
+    sstream << "  Placement: " << (cpuAffinity_.empty() ? "unpinned" : "pinned") << ", CPUs " << redis_store::formatCpuList(placementCpus_)
+            << ", NUMA nodes " << (placementNodes_.empty() ? std::string("unknown") : redis_store::formatCpuList(placementNodes_))
+            << (localQueries_ ? ", local query copy" : "") << std::endl;
+    if (virtualClients_ > 0) {
+        sstream << "  Result API: async, " << std::to_string(virtualClients_) << " virtual clients on " << std::to_string(executor_->getThreadCount())
+                << " executor threads" << std::endl;
+    }
+    else if (maxInflight_ > 0) {
+        sstream << "  Result API: async, " << std::to_string(maxInflight_) << " queries in flight" << std::endl;
+    }
+    else {
+        sstream << "  Result API: " << resultApiToString(resultApi_) << std::endl;
+    }
+    if (replaySpeedup_ > 0.0) {
+        sstream << "  Replay of logged query times at " << std::to_string(replaySpeedup_) << "x speed" << std::endl;
+    }
+    if ((openLoopRate_ > 0.0) || (replaySpeedup_ > 0.0)) {
+        if (openLoopRate_ > 0.0) {
+            sstream << "  Open loop target rate: " << std::to_string(openLoopRate_) << " queries/second ("
+                    << arrivalDistributionToString(arrivalDistribution_) << " arrivals)" << std::endl;
         }
-        else {
-            percentilePrefix = "p";
+        if (runtime > 0) {
+            sstream << "  Open loop achieved rate: " << std::to_string((double)querySuccessCount * 1000.0 / (double)runtime) << " queries/second"
+                    << std::endl;
         }
-        sstream << "      " << getName() << " query times elapsed(microseconds)   " << percentilePrefix << std::to_string(p) << ": "
-                << std::to_string(findPercentile(p, &individualQueryTimesMicro)) << std::endl;
+        sstream << "  Open loop max send lag: " << std::to_string(maxSendLagMicro_) << " microseconds" << std::endl;
+    }
+    if (totalFetchedObjects > 0) {
+        sstream << "  Query time per fetched object: " << std::to_string((double)queryTimesMicro_.getValueSum() * 1000.0 / (double)totalFetchedObjects)
+                << " nanoseconds" << std::endl;
+    }
+    if (redis_store::allocationCountingEnabled() && (queryCount > 0)) {
+        sstream << "  Allocations per query: " << std::to_string((double)allocationCount_ / (double)queryCount) << std::endl;
+    }
+
+    sstream << fetchMetrics_.toString("  ");
+
+    sstream << "  Query times recorded: " << std::to_string(queryTimesMicro_.getTotalCount()) << ", mean "
+            << std::to_string(queryTimesMicro_.getMean()) << " microseconds, histogram " << std::to_string(queryTimesMicro_.getMemoryUsage())
+            << " bytes" << std::endl;
+    sstream << queryTimesMicro_.toString("      ", getName() + " query times");
+    if (serviceTimesMicro_.getTotalCount() > 0) {
+        // Open loop query times above run from the intended send time
+        sstream << serviceTimesMicro_.toString("      ", getName() + " service times");
     }
 
     report_ = sstream.str();
@@ -215,4 +901,38 @@ std::string QueryRunner::getReport() {
     return report_;
 }
 
+Json::Value QueryRunner::getResultJson() {
+    Json::Value result;
+    result["id"] = id_;
+    result["queries"] = (Json::UInt64)runQueryCount_;
+    result["successes"] = (Json::UInt64)querySuccessCount_;
+    result["fetched_objects"] = (Json::UInt64)fetchedObjectCount_;
+    result["runtime_ms"] = (Json::Int64)runtimeMilliseconds_;
+    result["cluster_client"] = (Json::UInt64)clusterClient_;
+    result["placement"]["pinned"] = !cpuAffinity_.empty();
+    result["placement"]["cpus"] = redis_store::formatCpuList(placementCpus_);
+    result["placement"]["numa_nodes"] = redis_store::formatCpuList(placementNodes_);
+    result["placement"]["local_queries"] = localQueries_;
+    result["query_times"] = queryTimesMicro_.toJson();
+    if (serviceTimesMicro_.getTotalCount() > 0) {
+        result["service_times"] = serviceTimesMicro_.toJson();
+    }
+    if (redis_store::allocationCountingEnabled()) {
+        result["allocations"] = (Json::UInt64)allocationCount_;
+    }
+    return result;
+}
+
+const redis_store::FetchMetrics& QueryRunner::getFetchMetrics() {
+    return fetchMetrics_;
+}
+
+const redis_store::LatencyHistogram& QueryRunner::getQueryTimes() {
+    return queryTimesMicro_;
+}
+
+const redis_store::LatencyHistogram& QueryRunner::getServiceTimes() {
+    return serviceTimesMicro_;
+}
+
 }  // namespace query_runner
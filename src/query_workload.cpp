@@ -0,0 +1,485 @@
+#include <fcntl.h>
+#include <redis_workload/mapped_file.h>
+#include <redis_workload/query_workload.h>
+#include <redis_workload/util.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+using redis_store::getRedisHashslotGenerator;
+using redis_store::RedisHashSlotGenerator;
+
+namespace query_runner {
+
+static const size_t kWorkloadSectionAlignment = 8;
+
+inline size_t alignSection(size_t pos) {
+    return (pos + kWorkloadSectionAlignment - 1) & ~(kWorkloadSectionAlignment - 1);
+}
+
+QueryWorkload::QueryWorkload() {
+    pointAtOwnedStorage();
+}
+
+void QueryWorkload::pointAtOwnedStorage() {
+    keyArenaData_ = keyArena_.data();
+    keyOffsetsData_ = keyOffsets_.data();
+    queryOffsetsData_ = queryOffsets_.data();
+    queryKeyIdsData_ = queryKeyIds_.data();
+    keyHashslotsData_ = keyHashslots_.data();
+    queryTimesData_ = queryTimes_.empty() ? nullptr : queryTimes_.data();
+    keyCount_ = keyOffsets_.size() - 1;
+    queryCount_ = queryOffsets_.size() - 1;
+    queryKeysTotal_ = queryKeyIds_.size();
+    keyArenaSize_ = keyArena_.size();
+    findFirstQueryTime();
+}
+
+void QueryWorkload::findFirstQueryTime() {
+    firstQueryTime_ = 0;
+    if ((queryTimesData_ != nullptr) && (queryCount_ > 0)) {
+        firstQueryTime_ = *std::min_element(queryTimesData_, queryTimesData_ + queryCount_);
+    }
+}
+
+size_t QueryWorkload::getMemoryUsage() const {
+    if (image_ != nullptr) {
+        return getBinaryImageSize();
+    }
+    return keyArena_.capacity() + (keyOffsets_.capacity() * sizeof(uint64_t)) + (queryOffsets_.capacity() * sizeof(uint64_t))
+           + (queryKeyIds_.capacity() * sizeof(key_id_t)) + (keyHashslots_.capacity() * sizeof(uint16_t))
+           + (queryTimes_.capacity() * sizeof(int64_t));
+}
+
+/**
+ * Calculate the section layout of the binary image for the given counts.
+ * The query times section is only laid out when hasQueryTimes is set.
+ * Returns the total image size.
+ */
+static size_t layoutBinaryImage(WorkloadFileHeader& header, bool hasQueryTimes) {
+    size_t pos = alignSection(sizeof(WorkloadFileHeader));
+    header.keyOffsetsPos = pos;
+    pos = alignSection(pos + ((header.keyCount + 1) * sizeof(uint64_t)));
+    header.queryOffsetsPos = pos;
+    pos = alignSection(pos + ((header.queryCount + 1) * sizeof(uint64_t)));
+    header.queryKeyIdsPos = pos;
+    pos = alignSection(pos + (header.queryKeysTotal * sizeof(key_id_t)));
+    header.keyHashslotsPos = pos;
+    pos = alignSection(pos + (header.keyCount * sizeof(uint16_t)));
+    header.queryTimesPos = 0;
+    if (hasQueryTimes) {
+        header.queryTimesPos = pos;
+        pos = alignSection(pos + (header.queryCount * sizeof(int64_t)));
+    }
+    header.keyArenaPos = pos;
+    pos = pos + header.keyArenaSize;
+    header.fileSize = pos;
+    return pos;
+}
+
+static WorkloadFileHeader makeHeader(size_t keyCount, size_t queryCount, size_t queryKeysTotal, size_t keyArenaSize, bool hasQueryTimes) {
+    WorkloadFileHeader header {};
+    memcpy(header.magic, kWorkloadFileMagic, sizeof(header.magic));
+    header.version = kWorkloadFileVersion;
+    header.headerSize = sizeof(WorkloadFileHeader);
+    header.keyCount = keyCount;
+    header.queryCount = queryCount;
+    header.queryKeysTotal = queryKeysTotal;
+    header.keyArenaSize = keyArenaSize;
+    layoutBinaryImage(header, hasQueryTimes);
+    return header;
+}
+
+size_t QueryWorkload::getBinaryImageSize() const {
+    return makeHeader(keyCount_, queryCount_, queryKeysTotal_, keyArenaSize_, hasQueryTimes()).fileSize;
+}
+
+void QueryWorkload::writeBinaryImage(char* dest) const {
+    WorkloadFileHeader header = makeHeader(keyCount_, queryCount_, queryKeysTotal_, keyArenaSize_, hasQueryTimes());
+
+    memset(dest, 0, header.fileSize);
+    memcpy(dest + header.keyOffsetsPos, keyOffsetsData_, (keyCount_ + 1) * sizeof(uint64_t));
+    memcpy(dest + header.queryOffsetsPos, queryOffsetsData_, (queryCount_ + 1) * sizeof(uint64_t));
+    memcpy(dest + header.queryKeyIdsPos, queryKeyIdsData_, queryKeysTotal_ * sizeof(key_id_t));
+    memcpy(dest + header.keyHashslotsPos, keyHashslotsData_, keyCount_ * sizeof(uint16_t));
+    if (hasQueryTimes()) {
+        memcpy(dest + header.queryTimesPos, queryTimesData_, queryCount_ * sizeof(int64_t));
+    }
+    memcpy(dest + header.keyArenaPos, keyArenaData_, keyArenaSize_);
+    // The header goes last so a reader never sees the magic before the data
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(dest, &header, sizeof(header));
+}
+
+void QueryWorkload::writeBinaryFile(const std::string& filename) const {
+    size_t imageSize = getBinaryImageSize();
+
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create file: " + filename);
+    }
+    if (ftruncate(fd, static_cast<off_t>(imageSize)) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not resize file: " + filename);
+    }
+
+    void* mapping = mmap(nullptr, imageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+
+    writeBinaryImage(static_cast<char*>(mapping));
+    munmap(mapping, imageSize);
+}
+
+static void checkImage(bool condition, const std::string& reason) {
+    if (!condition) {
+        throw std::runtime_error("Invalid binary workload: " + reason);
+    }
+}
+
+std::shared_ptr<const QueryWorkload> QueryWorkload::fromBinaryImage(std::shared_ptr<const void> image, const char* data, size_t size) {
+    checkImage(size >= sizeof(WorkloadFileHeader), "image too small");
+
+    WorkloadFileHeader header {};
+    memcpy(&header, data, sizeof(header));
+    checkImage(memcmp(header.magic, kWorkloadFileMagic, sizeof(header.magic)) == 0, "bad magic");
+    checkImage(header.version == kWorkloadFileVersion,
+               "unsupported version " + std::to_string(header.version) + ", recreate the file with compile_redis_workload");
+    checkImage(header.headerSize == sizeof(WorkloadFileHeader), "unexpected header size");
+
+    // Counts no image of this size can hold would overflow the layout
+    checkImage(header.keyCount < size && header.queryCount < size && header.queryKeysTotal < size && header.keyArenaSize <= size, "counts exceed the image size");
+    WorkloadFileHeader expected = makeHeader(header.keyCount, header.queryCount, header.queryKeysTotal, header.keyArenaSize, header.queryTimesPos != 0);
+    checkImage(header.fileSize == expected.fileSize && header.keyOffsetsPos == expected.keyOffsetsPos && header.queryOffsetsPos == expected.queryOffsetsPos
+                   && header.queryKeyIdsPos == expected.queryKeyIdsPos && header.keyHashslotsPos == expected.keyHashslotsPos
+                   && header.queryTimesPos == expected.queryTimesPos && header.keyArenaPos == expected.keyArenaPos,
+               "inconsistent section layout");
+    checkImage(header.fileSize <= size, "truncated image");
+
+    auto workload = std::make_shared<QueryWorkload>();
+    workload->image_ = std::move(image);
+    workload->keyOffsetsData_ = reinterpret_cast<const uint64_t*>(data + header.keyOffsetsPos);
+    workload->queryOffsetsData_ = reinterpret_cast<const uint64_t*>(data + header.queryOffsetsPos);
+    workload->queryKeyIdsData_ = reinterpret_cast<const key_id_t*>(data + header.queryKeyIdsPos);
+    workload->keyHashslotsData_ = reinterpret_cast<const uint16_t*>(data + header.keyHashslotsPos);
+    if (header.queryTimesPos != 0) {
+        workload->queryTimesData_ = reinterpret_cast<const int64_t*>(data + header.queryTimesPos);
+    }
+    workload->keyArenaData_ = data + header.keyArenaPos;
+    workload->keyCount_ = header.keyCount;
+    workload->queryCount_ = header.queryCount;
+    workload->queryKeysTotal_ = header.queryKeysTotal;
+    workload->keyArenaSize_ = header.keyArenaSize;
+
+    // Bounds of the offset tables and key ids, the per query and per key
+    // lookups are unchecked. Ascending offsets ending at the section size
+    // keep every key and query within its section.
+    checkImage(workload->keyOffsetsData_[header.keyCount] == header.keyArenaSize, "key arena size mismatch");
+    checkImage(workload->queryOffsetsData_[header.queryCount] == header.queryKeysTotal, "query key count mismatch");
+    checkImage(std::is_sorted(workload->keyOffsetsData_, workload->keyOffsetsData_ + header.keyCount + 1), "key offsets out of order");
+    checkImage(std::is_sorted(workload->queryOffsetsData_, workload->queryOffsetsData_ + header.queryCount + 1), "query offsets out of order");
+    checkImage(std::all_of(workload->queryKeyIdsData_,
+                           workload->queryKeyIdsData_ + header.queryKeysTotal,
+                           [&header](key_id_t id) {
+                               return id < header.keyCount;
+                           }),
+               "key id out of range");
+
+    workload->findFirstQueryTime();
+
+    return workload;
+}
+
+std::shared_ptr<const QueryWorkload> QueryWorkload::loadBinaryFile(const std::string& filename) {
+    auto file = std::make_shared<MappedFile>(filename);
+    return fromBinaryImage(file, file->data(), file->size());
+}
+
+WorkloadSource WorkloadSource::fromFile(const std::string& filename, bool csvQueryTimes) {
+    struct stat fileStat {};
+    if (stat(filename.c_str(), &fileStat) != 0) {
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+
+    WorkloadSource source;
+    char resolved[PATH_MAX];
+    source.path = (realpath(filename.c_str(), resolved) != nullptr) ? std::string(resolved) : filename;
+    source.size = fileStat.st_size;
+    source.mtimeNanos = (fileStat.st_mtim.tv_sec * 1000000000LL) + fileStat.st_mtim.tv_nsec;
+    source.csvQueryTimes = csvQueryTimes;
+    return source;
+}
+
+std::string WorkloadSource::toString() const {
+    return path + " (" + std::to_string(size) + " bytes, modified " + std::to_string(mtimeNanos) + " ns" + (csvQueryTimes ? ", -T" : "") + ")";
+}
+
+/**
+ * Start of a shared memory segment, followed by the binary image at
+ * kSharedImagePos. Written before the image, whose header is published
+ * last.
+ */
+struct SharedWorkloadHeader {
+    char magic[8];
+    char sourcePath[PATH_MAX];
+    uint64_t sourceSize;
+    int64_t sourceMtimeNanos;
+    uint32_t csvQueryTimes;
+    uint32_t reserved;
+};
+
+static const char kSharedWorkloadMagic[8] = {'R', 'W', 'L', 'S', 'H', 'M', '\0', '\0'};
+static const size_t kSharedImagePos = alignSection(sizeof(SharedWorkloadHeader));
+
+static void writeSharedHeader(char* dest, const WorkloadSource& source) {
+    if (source.path.size() >= sizeof(SharedWorkloadHeader::sourcePath)) {
+        throw std::runtime_error("Data file path too long for a shared memory segment: " + source.path);
+    }
+    SharedWorkloadHeader header {};
+    memcpy(header.magic, kSharedWorkloadMagic, sizeof(header.magic));
+    memcpy(header.sourcePath, source.path.data(), source.path.size());
+    header.sourceSize = source.size;
+    header.sourceMtimeNanos = source.mtimeNanos;
+    header.csvQueryTimes = source.csvQueryTimes ? 1 : 0;
+    memcpy(dest, &header, sizeof(header));
+}
+
+static WorkloadSource readSharedHeader(const char* data) {
+    SharedWorkloadHeader header {};
+    memcpy(&header, data, sizeof(header));
+    WorkloadSource source;
+    source.path = std::string(header.sourcePath, strnlen(header.sourcePath, sizeof(header.sourcePath)));
+    source.size = header.sourceSize;
+    source.mtimeNanos = header.sourceMtimeNanos;
+    source.csvQueryTimes = (header.csvQueryTimes != 0);
+    return source;
+}
+
+static const int kSharedMemoryPollIntervalMs = 10;
+
+/**
+ * Wait until the segment has been sized and the image header published,
+ * check the segment was published from the same source, then map the
+ * segment read-only.
+ */
+static std::shared_ptr<const QueryWorkload> attachSharedMemory(int fd, const std::string& name, const WorkloadSource& source, std::chrono::seconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        struct stat segmentStat {};
+        if (fstat(fd, &segmentStat) != 0) {
+            throw std::runtime_error("Could not stat shared memory segment: " + name);
+        }
+
+        size_t segmentSize = static_cast<size_t>(segmentStat.st_size);
+        if (segmentSize >= sizeof(WorkloadFileHeader)) {
+            auto segment = std::make_shared<MappedFile>(fd, name);
+            // Segments of earlier versions hold the image alone, and are
+            // never published again in this layout
+            if (memcmp(segment->data(), kWorkloadFileMagic, sizeof(kWorkloadFileMagic)) == 0) {
+                throw std::runtime_error("Shared memory segment " + name + " was written by an older version, remove it from /dev/shm");
+            }
+
+            char magic[sizeof(kWorkloadFileMagic)] = {};
+            if (segmentSize >= kSharedImagePos + sizeof(WorkloadFileHeader)) {
+                memcpy(magic, segment->data() + kSharedImagePos, sizeof(magic));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (memcmp(magic, kWorkloadFileMagic, sizeof(magic)) == 0) {
+                WorkloadSource published = readSharedHeader(segment->data());
+                if (!(published == source)) {
+                    throw std::runtime_error("Shared memory segment " + name + " holds the workload of " + published.toString() + ", not "
+                                             + source.toString() + ", remove it from /dev/shm or choose another segment name");
+                }
+                return QueryWorkload::fromBinaryImage(segment, segment->data() + kSharedImagePos, segment->size() - kSharedImagePos);
+            }
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("Timed out waiting for workload in shared memory segment: " + name);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kSharedMemoryPollIntervalMs));
+    }
+}
+
+std::shared_ptr<const QueryWorkload> QueryWorkload::openSharedMemory(const std::string& name,
+                                                                     const WorkloadSource& source,
+                                                                     const std::function<std::shared_ptr<const QueryWorkload>()>& loader,
+                                                                     std::chrono::seconds timeout) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        if (errno != EEXIST) {
+            throw std::runtime_error("Could not create shared memory segment: " + name);
+        }
+
+        fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open shared memory segment: " + name);
+        }
+        std::cout << "Attaching to workload in shared memory segment: " << name << std::endl;
+        try {
+            auto workload = attachSharedMemory(fd, name, source, timeout);
+            close(fd);
+            return workload;
+        }
+        catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    std::cout << "Publishing workload in shared memory segment: " << name << std::endl;
+    try {
+        std::shared_ptr<const QueryWorkload> workload = loader();
+        size_t segmentSize = kSharedImagePos + workload->getBinaryImageSize();
+        if (ftruncate(fd, static_cast<off_t>(segmentSize)) != 0) {
+            throw std::runtime_error("Could not resize shared memory segment: " + name);
+        }
+
+        void* mapping = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Could not map shared memory segment: " + name);
+        }
+        // The image header is written last, after the source, and publishes both
+        writeSharedHeader(static_cast<char*>(mapping), source);
+        workload->writeBinaryImage(static_cast<char*>(mapping) + kSharedImagePos);
+        munmap(mapping, segmentSize);
+
+        // Switch to the shared copy so the private one can be released
+        workload = attachSharedMemory(fd, name, source, timeout);
+        close(fd);
+        return workload;
+    }
+    catch (...) {
+        // Do not leave a segment behind that other processes would wait on
+        close(fd);
+        shm_unlink(name.c_str());
+        throw;
+    }
+}
+
+bool QueryWorkload::isBinaryFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(kWorkloadFileMagic)] = {};
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, kWorkloadFileMagic, sizeof(magic)) == 0;
+}
+
+QueryWorkloadBuilder::QueryWorkloadBuilder() : workload_(std::make_shared<QueryWorkload>()) {}
+
+key_id_t QueryWorkloadBuilder::internKey(std::string_view key) {
+    auto [it, inserted] = keyIds_.try_emplace(key, static_cast<key_id_t>(keys_.size()));
+    if (inserted) {
+        if (keys_.size() == UINT32_MAX) {
+            throw std::length_error("workload exceeds the maximum number of distinct keys");
+        }
+        keys_.push_back(key);
+    }
+    return it->second;
+}
+
+void QueryWorkloadBuilder::addQuery(std::span<const std::string_view> keys) {
+    if (!workload_->queryTimes_.empty()) {
+        throw std::logic_error("query added without a time to a workload with query times");
+    }
+    appendQuery(keys);
+}
+
+void QueryWorkloadBuilder::addQuery(std::span<const std::string_view> keys, int64_t queryTime) {
+    if (workload_->queryTimes_.size() != workload_->queryOffsets_.size() - 1) {
+        throw std::logic_error("query added with a time to a workload without query times");
+    }
+    appendQuery(keys);
+    workload_->queryTimes_.push_back(queryTime);
+}
+
+void QueryWorkloadBuilder::appendQuery(std::span<const std::string_view> keys) {
+    for (const auto& k : keys) {
+        workload_->queryKeyIds_.push_back(internKey(k));
+    }
+    workload_->queryOffsets_.push_back(workload_->queryKeyIds_.size());
+}
+
+std::shared_ptr<const QueryWorkload> QueryWorkloadBuilder::build() {
+    RedisHashSlotGenerator* hashSlotGenerator = getRedisHashslotGenerator();
+
+    size_t arenaSize = 0;
+    for (const auto& k : keys_) {
+        arenaSize += k.size();
+    }
+
+    workload_->keyArena_.reserve(arenaSize);
+    workload_->keyOffsets_.reserve(keys_.size() + 1);
+    workload_->keyHashslots_.reserve(keys_.size());
+    for (const auto& k : keys_) {
+        workload_->keyArena_.append(k);
+        workload_->keyOffsets_.push_back(workload_->keyArena_.size());
+        // getHashslotForKey rejects empty keys, CRC16 of an empty hashtag is 0
+        workload_->keyHashslots_.push_back(k.empty() ? 0 : hashSlotGenerator->getHashslotForKey(k));
+    }
+    workload_->queryKeyIds_.shrink_to_fit();
+    workload_->queryOffsets_.shrink_to_fit();
+    workload_->queryTimes_.shrink_to_fit();
+    workload_->pointAtOwnedStorage();
+
+    keyIds_.clear();
+    keys_.clear();
+    return std::move(workload_);
+}
+
+QueryBucket::QueryBucket(std::shared_ptr<const QueryWorkload> workload, size_t first, size_t stride) :
+    workload_(std::move(workload)),
+    first_(first),
+    stride_(stride) {
+    size_t queryCount = workload_->getQueryCount();
+    count_ = (first_ < queryCount) ? ((queryCount - first_ + stride_ - 1) / stride_) : 0;
+}
+
+QueryBucket QueryBucket::copyQueries() const {
+    auto workload = std::make_shared<QueryWorkload>();
+    std::unordered_map<key_id_t, key_id_t> keyIds;
+    workload->queryOffsets_.reserve(count_ + 1);
+    if (hasQueryTimes()) {
+        workload->queryTimes_.reserve(count_);
+    }
+
+    for (size_t i = 0; i < count_; i++) {
+        for (key_id_t id : getQuery(i)) {
+            auto [entry, inserted] = keyIds.try_emplace(id, (key_id_t)workload->keyHashslots_.size());
+            if (inserted) {
+                workload->keyArena_.append(getKey(id));
+                workload->keyOffsets_.push_back(workload->keyArena_.size());
+                workload->keyHashslots_.push_back(getHashslot(id));
+            }
+            workload->queryKeyIds_.push_back(entry->second);
+        }
+        workload->queryOffsets_.push_back(workload->queryKeyIds_.size());
+        if (hasQueryTimes()) {
+            workload->queryTimes_.push_back(getQueryTime(i));
+        }
+    }
+    workload->keyArena_.shrink_to_fit();
+    workload->queryKeyIds_.shrink_to_fit();
+    workload->pointAtOwnedStorage();
+    workload->firstQueryTime_ = getFirstQueryTime();
+
+    return {workload, 0, 1};
+}
+
+}  // namespace query_runner
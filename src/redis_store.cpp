@@ -1,16 +1,21 @@
 #include <json/json.h>
+#include <redis_workload/cpu_affinity.h>
 #include <redis_workload/datatypes.h>
+#include <redis_workload/fetch_metrics.h>
 #include <redis_workload/redis_store.h>
 #include <redis_workload/redis_store_params.h>
 #include <redis_workload/util.h>
 
-#include <redis_workload/remove_duplicates.hpp>
-
 #ifdef USE_BOOST_FUTURE
     #include <boost/stacktrace.hpp>
 #endif  // USE_BOOST_FUTURE
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <utility>
@@ -19,23 +24,30 @@
 namespace redis_store {
 
 std::shared_ptr<RedisDataStore> RedisDataStore::redisDataStore_ = nullptr;
+std::atomic<uint64_t> RedisDataStore::nextGeneration_ = 0;
 
-std::shared_ptr<RedisDataStore> RedisDataStore::factory() {
-    if (redisDataStore_ != nullptr) {
-        std::cout << "warn: ignoring factory arguments because the "
-                     "RedisDataStore already exists"
-                  << std::endl;
-        return redisDataStore_;
-    }
+RedisStoreParams RedisDataStore::getDefaultParams(bool requireEnvironment) {
     /** Hard-code values to disconnect from config parsing */
-    std::pair<std::string, std::string> credentials = getRedisCredentialsFromEnv();
-    std::pair<std::string, int> host = getRedisHostFromEnv();
-
     RedisStoreParams params;
-    params.redisHost = host.first;
-    params.redisPort = host.second;
-    params.redisUser = credentials.first;
-    params.redisPassword = credentials.second;
+    if (requireEnvironment) {
+        std::pair<std::string, std::string> credentials = getRedisCredentialsFromEnv();
+        std::pair<std::string, int> host = getRedisHostFromEnv();
+        params.redisHost = host.first;
+        params.redisPort = host.second;
+        params.redisUser = credentials.first;
+        params.redisPassword = credentials.second;
+    }
+    else {
+        // Unset variables leave the fields for a config file or the
+        // command line to fill in, RedisStoreParams::valid() reports the rest
+        params.redisHost = getEnvVar("REDIS_HOST");
+        params.redisUser = getEnvVar("REDIS_USER");
+        params.redisPassword = getEnvVar("REDIS_PASS");
+        std::string port = getEnvVar("REDIS_PORT");
+        if (!port.empty()) {
+            params.set("port", port);
+        }
+    }
 
     params.maxMultiKeyBatchSize = 40;
     params.redisKeyPrefix = "test.datastore:v1:{";
@@ -46,6 +58,21 @@ std::shared_ptr<RedisDataStore> RedisDataStore::factory() {
     params.poolConnectionLifetime = 0;
     params.poolConnectionMaxIdle = 0;
 
+    return params;
+}
+
+std::shared_ptr<RedisDataStore> RedisDataStore::factory() {
+    return factory(getDefaultParams());
+}
+
+std::shared_ptr<RedisDataStore> RedisDataStore::factory(const RedisStoreParams& params) {
+    if (redisDataStore_ != nullptr) {
+        std::cout << "warn: ignoring factory arguments because the "
+                     "RedisDataStore already exists"
+                  << std::endl;
+        return redisDataStore_;
+    }
+
     redisDataStore_ = std::make_shared<RedisDataStore>(params);
 
     std::cout << "RedisDataStore connected to Redis server version: " << redisDataStore_->getRedisServerVersion() << std::endl;
@@ -54,15 +81,22 @@ std::shared_ptr<RedisDataStore> RedisDataStore::factory() {
     return redisDataStore_;
 }
 
+void RedisDataStore::release() {
+    redisDataStore_ = nullptr;
+}
+
 static const int REDIS_CONNECTION_RETRY_DELAY_MS = 10;
 static const int REDIS_CONNECTION_RETRY_COUNT = 3;
 
 RedisDataStore::RedisDataStore(const RedisStoreParams& params) :
     params_(params),
+    generation_(++nextGeneration_),
     maxMultiKeyBatchCount_(params.maxMultiKeyBatchSize),
     redisKeyPrefix_(params.redisKeyPrefix),
     redisKeySuffix_(params.redisKeySuffix),
-    datasetMetaDataKey(params.redisKeyPrefix + "dataset_metadata" + params.redisKeySuffix) {
+    datasetMetaDataKey(params.redisKeyPrefix + "dataset_metadata" + params.redisKeySuffix),
+    batchByNode_(params.batchByNode),
+    timeFetchStages_(params.timeFetchStages) {
     sw::redis::ConnectionOptions connectionOptions;
     connectionOptions.host = params_.redisHost;
     connectionOptions.port = params_.redisPort;
@@ -87,24 +121,66 @@ RedisDataStore::RedisDataStore(const RedisStoreParams& params) :
     connectionValues << "waitTimeout:" << std::to_string(params_.poolWaitTimeout) << ", ";
     connectionValues << "connectionLifetime:" << std::to_string(params_.poolConnectionLifetime) << ", ";
     connectionValues << "maxIdleTime:" << std::to_string(params_.poolConnectionMaxIdle) << ", ";
-    connectionValues << "maxMultiKeyBatchCount:" << std::to_string(maxMultiKeyBatchCount_);
+    connectionValues << "maxMultiKeyBatchCount:" << std::to_string(maxMultiKeyBatchCount_) << ", ";
+    connectionValues << "batchByNode:" << (batchByNode_ ? "true" : "false") << ", ";
+    connectionValues << "timeFetchStages:" << (timeFetchStages_ ? "true" : "false") << ", ";
+    connectionValues << "clusterClients:" << std::to_string(params_.clusterClients);
 
     std::string message = "Creating RedisDataStore with redis connection options:" + connectionValues.str();
     std::cout << message << std::endl;
 
-    // Note that the RedisCluster class is movable but not copyable
-    try {
-        auto redisCluster = sw::redis::AsyncRedisCluster(connectionOptions, poolOptions);
-        redisConnection_ = std::make_unique<sw::redis::AsyncRedisCluster>(std::move(redisCluster));
-    }
-    catch (sw::redis::Error& e) {
-        std::cerr << "error: Caught exception connecting to redis cluster: " << e.what() << std::endl;
+    std::vector<std::vector<int>> loopCpus;
+    if (!params_.clusterClientCpus.empty()) {
+        try {
+            loopCpus = parseCpuPlacement(params_.clusterClientCpus);
+        }
+        catch (std::invalid_argument& e) {
+            throw std::runtime_error(std::string("Invalid cluster client placement: ") + e.what());
+        }
     }
-    catch (...) {
-        std::cout << "Caught exception during AsyncRedisCluster create" << std::endl;
+    std::vector<int> callerCpus = getThreadAffinity();
+
+    // Every client starts its own event loop thread, which inherits the
+    // CPU affinity of this thread while the client is created
+    for (int c = 0; c < std::max(params_.clusterClients, 1); c++) {
+        std::vector<int> loopCpu = loopCpus.empty() ? std::vector<int>() : loopCpus[c % loopCpus.size()];
+        // Note that the RedisCluster class is movable but not copyable
+        try {
+            if (!loopCpu.empty()) {
+                setThreadAffinity(loopCpu);
+            }
+            auto redisCluster = sw::redis::AsyncRedisCluster(connectionOptions, poolOptions);
+            redisConnections_.push_back(std::make_unique<sw::redis::AsyncRedisCluster>(std::move(redisCluster)));
+            redisConnectionCpus_.push_back(loopCpu);
+        }
+        catch (sw::redis::Error& e) {
+            std::cerr << "error: Caught exception connecting to redis cluster: " << e.what() << std::endl;
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << "error: Caught exception creating cluster client " << std::to_string(c) << ": " << e.what() << std::endl;
+        }
+        catch (...) {
+            std::cout << "Caught exception during AsyncRedisCluster create" << std::endl;
 #ifdef USE_BOOST_FUTURE
-        std::cout << boost::stacktrace::stacktrace();
+            std::cout << boost::stacktrace::stacktrace();
 #endif  // USE_BOOST_FUTURE
+        }
+        if (!loopCpu.empty()) {
+            setThreadAffinity(callerCpus);
+        }
+    }
+    if (redisConnections_.empty()) {
+        throw std::runtime_error("Cannot create a redis cluster client");
+    }
+    if (redisConnections_.size() > 1) {
+        std::cout << "Created " << std::to_string(redisConnections_.size()) << " cluster clients" << std::endl;
+    }
+    for (size_t c = 0; c < redisConnectionCpus_.size(); c++) {
+        if (!redisConnectionCpus_[c].empty()) {
+            std::vector<int> nodes = getNumaNodesOfCpus(redisConnectionCpus_[c]);
+            std::cout << "Cluster client " << std::to_string(c) << " event loop CPUs: " << formatCpuList(redisConnectionCpus_[c])
+                      << ", NUMA nodes: " << (nodes.empty() ? std::string("unknown") : formatCpuList(nodes)) << std::endl;
+        }
     }
 
     bool operationSuccess = false;
@@ -144,6 +220,17 @@ RedisDataStore::RedisDataStore(const RedisStoreParams& params) :
             std::this_thread::sleep_for(std::chrono::milliseconds(retryDelayMs));
         }
     }
+
+    if (batchByNode_) {
+        refreshClusterTopology(topologyEpoch_.load());
+        if (topology_ == nullptr) {
+            std::cout << "warn: Redis Cluster topology unavailable, node batching disabled" << std::endl;
+            batchByNode_ = false;
+        }
+        else {
+            std::cout << "Redis Cluster topology:" << std::endl << topology_->toString();
+        }
+    }
 }
 
 std::string RedisDataStore::getDatasetVersionFromDatasetMeta(const std::string& meta_string) {
@@ -186,11 +273,12 @@ std::string RedisDataStore::getRedisServerVersionFromInfo(const std::string& inf
     return serverVersion;
 }
 
-void RedisDataStore::zipResultObjects(const std::shared_ptr<vector_keys_t>& keys,
-                                      const std::shared_ptr<vector_results_t>& dataObjects,
-                                      const std::shared_ptr<multiget_result_map_t>& zippedData) {
-    size_t keysCount = keys->size();
-    size_t redisResultsCount = dataObjects->size();
+void RedisDataStore::zipResultObjects(std::span<const std::string_view> keys,
+                                      vector_results_t& dataObjects,
+                                      multiget_result_map_t& zippedData,
+                                      bool indexByHashtag) {
+    size_t keysCount = keys.size();
+    size_t redisResultsCount = dataObjects.size();
 
     if (redisResultsCount != keysCount) {
         std::string message = ("warn: Redis Data Store zip requested with dataObjects count: " + std::to_string(redisResultsCount)
@@ -198,18 +286,17 @@ void RedisDataStore::zipResultObjects(const std::shared_ptr<vector_keys_t>& keys
         std::cout << message << std::endl;
     }
 
-    for (size_t i = 0; i < redisResultsCount; i++) {
-        std::string key = keys->at(i);
-        sw::redis::OptionalString blob = dataObjects->at(i);
-
-        zippedData->insert({key, blob});
+    size_t zipCount = std::min(keysCount, redisResultsCount);
+    for (size_t i = 0; i < zipCount; i++) {
+        std::string_view key = (indexByHashtag ? getFeatureIDFromKey(redisKeyPrefix_, redisKeySuffix_, keys[i]) : keys[i]);
+        zippedData.emplace(std::string(key), std::move(dataObjects[i]));
     }
 }
 
 std::string RedisDataStore::issueSynchronousRedisClusterStringCommand(const std::initializer_list<const char*>& command) {
     sw::redis::OptionalString result;
     std::string hashtag = "0";
-    result = redisConnection_->command<sw::redis::OptionalString>(command.begin(), command.end()).get();
+    result = redisConnections_.front()->command<sw::redis::OptionalString>(command.begin(), command.end()).get();
 
     return (result.has_value() ? result.value() : "");
 }
@@ -217,32 +304,88 @@ std::string RedisDataStore::issueSynchronousRedisClusterStringCommand(const std:
 std::string RedisDataStore::issueSynchronousRedisStringCommand(const std::initializer_list<const char*>& command, std::string hashtag) {
     sw::redis::OptionalString result;
 
-    auto redis = redisConnection_->redis(hashtag);
+    auto redis = redisConnections_.front()->redis(hashtag);
     result = redis.command<sw::redis::OptionalString>(command.begin(), command.end()).get();
 
     return (result.has_value() ? result.value() : "");
 }
 
-// TODO: Array unpacking seems to be broken for redis++ ASync interface
-//[[maybe_unused]] void RedisDataStore::issueSynchronousRedisArrayCommand(const std::initializer_list<const char*>& command) {
-//    std::vector<std::string> result;
-//
-//    std::cout << "requested command length: " << command.size() << std::endl;
-//
-//    std::cout << "example from github.com" << std::endl;
-//    auto r = redisConnection_->redis("0");
-//    std::cout << "got AsyncRedis instance" << std::endl;
-//    using SlotInfo = std::tuple<std::string, long long, std::string>;
-//    using SlotMap = std::vector<std::variant<long long, SlotInfo>>;
-//    auto slots = r.command<std::vector<SlotMap>>("CLUSTER", "SLOTS");
-//
-//    std::cout << "CLUSTER SLOTS complete" << std::endl;
-//}
+/*
+ * Array unpacking of the CLUSTER SLOTS reply is broken for the redis++ Async
+ * interface, so the slot map is read from the CLUSTER NODES text reply.
+ */
+std::shared_ptr<const ClusterTopology> RedisDataStore::getClusterSlots() {
+    std::string clusterNodes = issueSynchronousRedisClusterStringCommand({"CLUSTER", "NODES"});
+    return std::make_shared<const ClusterTopology>(ClusterTopology::fromClusterNodes(clusterNodes));
+}
+
+void RedisDataStore::refreshClusterTopology(uint64_t observedEpoch) {
+    std::lock_guard<std::mutex> lock(topologyMutex_);
+    if (topologyEpoch_.load() != observedEpoch) {
+        // Another thread refreshed the topology while this one waited
+        return;
+    }
+
+    try {
+        topology_ = getClusterSlots();
+        topologyEpoch_++;
+    }
+    catch (sw::redis::Error& e) {
+        std::cout << "warn: Redis Cluster topology refresh failed: " << e.what() << std::endl;
+    }
+    catch (std::runtime_error& e) {
+        std::cout << "warn: Redis Cluster topology refresh failed: " << e.what() << std::endl;
+    }
+}
+
+std::shared_ptr<const ClusterTopology> RedisDataStore::getClusterTopology() {
+    std::lock_guard<std::mutex> lock(topologyMutex_);
+    return topology_;
+}
+
+/**
+ * The cluster client a thread sends through.
+ */
+struct thread_client_t {
+    // Generation of the store the index belongs to, 0 for none
+    uint64_t generation = 0;
+    size_t index = 0;
+};
+
+static thread_local thread_client_t threadClient;
+
+void RedisDataStore::bindThreadToClient(size_t clientIndex) {
+    threadClient.generation = generation_;
+    threadClient.index = clientIndex % redisConnections_.size();
+}
+
+size_t RedisDataStore::getThreadClientIndex() {
+    if (threadClient.generation != generation_) {
+        bindThreadToClient(nextThreadClient_.fetch_add(1, std::memory_order_relaxed));
+    }
+    return threadClient.index;
+}
+
+sw::redis::AsyncRedisCluster& RedisDataStore::getThreadClient() {
+    return *redisConnections_[getThreadClientIndex()];
+}
 
+/**
+ * Per-thread connections to the cluster nodes, one per node of the
+ * topology they were opened for, through the thread's cluster client.
+ */
+struct node_connections_t {
+    // Generation of the store the connections belong to, 0 for none
+    uint64_t generation = 0;
+    size_t client = 0;
+    uint64_t epoch = 0;
+    std::shared_ptr<const ClusterTopology> topology;
+    std::vector<std::unique_ptr<sw::redis::AsyncRedis>> nodes;
+};
 
 void RedisDataStore::redisGet(const std::string& key, std::string* result) {
     sw::redis::OptionalString data;
-    data = redisConnection_->get(key).get();
+    data = getThreadClient().get(key).get();
 
     *result = (data.has_value() ? data.value() : "");
 }
@@ -256,97 +399,426 @@ void RedisDataStore::redisGet(const std::string& key, std::string* result) {
  * each group. After all calls are issued, this method iterates over the futures
  * to collect the result data.
  *
- * @param keys a vector of Redis keys that hash to a single Redis hashslot.
+ * @param hashslotGroups Redis keys grouped by the hashslot they hash to.
  * @param results a map of key:value pairs retrieved from Redis.
  * @param indexByHashtag boolean indication whether the results should be
  * indexed by Redis key or geoID int
  */
-void RedisDataStore::crossslotRedisMget(vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag) {
-    hashslot_key_groups_t hashslotGroups;
-    groupKeysByRedisHashslot(keys, hashslotGroups);
+void RedisDataStore::crossslotRedisMget(const HashslotKeyGroups& hashslotGroups,
+                                        const std::shared_ptr<multiget_result_map_t>& results,
+                                        bool indexByHashtag) {
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    mget_future_slices_t& futureSlices = issueCrossslotRedisMget(hashslotGroups);
+    stageClock.lap(FetchStage::issue);
+
+    // Iterate over Futures and map result data to keys
+    for (mget_future_slice_t& slice : futureSlices) {
+        vector_results_t sliceResults = getSliceResults(slice);
+        stageClock.lap(FetchStage::wait);
+        zipResultObjects(slice.keys, sliceResults, *results, indexByHashtag);
+        stageClock.lap(FetchStage::collect);
+    }
+    futureSlices.clear();
+}
+
+/**
+ * Move the results of an MGET slice to the distinct key positions of its keys.
+ */
+static void placeSliceResults(const HashslotKeyGroups& hashslotGroups,
+                              std::span<const std::string_view> sliceKeys,
+                              vector_results_t& sliceResults,
+                              vector_results_t& distinctResults) {
+    size_t first = hashslotGroups.getKeyIndex(sliceKeys);
+    size_t count = std::min(sliceKeys.size(), sliceResults.size());
+    if (sliceResults.size() != sliceKeys.size()) {
+        std::cout << "warn: Redis Data Store MGET returned " << std::to_string(sliceResults.size()) << " objects for "
+                  << std::to_string(sliceKeys.size()) << " keys" << std::endl;
+    }
+    std::move(sliceResults.begin(), sliceResults.begin() + (long)count, distinctResults.begin() + (long)first);
+}
+
+/**
+ * Store the results of the distinct keys in the order of the keys
+ * originally grouped, copying the result of repeated keys.
+ */
+static void alignResults(const HashslotKeyGroups& hashslotGroups, vector_results_t& distinctResults, vector_results_t& results) {
+    // Remaining input positions of each distinct key, so the last one can
+    // take the value without a copy
+    static thread_local std::vector<uint32_t> keyUseCounts;
+
+    std::span<const uint32_t> keyIndexByPosition = hashslotGroups.getKeyIndexByPosition();
+    keyUseCounts.assign(distinctResults.size(), 0);
+    for (uint32_t keyIndex : keyIndexByPosition) {
+        keyUseCounts[keyIndex]++;
+    }
+
+    results.resize(keyIndexByPosition.size());
+    for (size_t i = 0; i < keyIndexByPosition.size(); i++) {
+        uint32_t keyIndex = keyIndexByPosition[i];
+        if (--keyUseCounts[keyIndex] == 0) {
+            results[i] = std::move(distinctResults[keyIndex]);
+        }
+        else {
+            results[i] = distinctResults[keyIndex];
+        }
+    }
+}
+
+/**
+ * Divide keys into sliceCount segments with sizes differing by at most one
+ * key and call issueSlice for each segment.
+ */
+template <typename IssueSlice>
+static void forEachBatchSlice(std::span<const std::string_view> keys, size_t sliceCount, IssueSlice&& issueSlice) {
+    size_t keysCount = keys.size();
+    size_t first = 0;
+    for (size_t i = 0; i < sliceCount; i++) {
+        size_t sliceSize = (keysCount / sliceCount) + ((i < keysCount % sliceCount) ? 1 : 0);
+        issueSlice(keys.subspan(first, sliceSize));
+        first += sliceSize;
+    }
+}
+
+void RedisDataStore::crossslotRedisMget(const HashslotKeyGroups& hashslotGroups, vector_results_t& results) {
+    // Results for the distinct keys, in hashslot group order
+    static thread_local vector_results_t distinctResults;
+
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    mget_future_slices_t& futureSlices = issueCrossslotRedisMget(hashslotGroups);
+    stageClock.lap(FetchStage::issue);
+
+    distinctResults.clear();
+    distinctResults.resize(hashslotGroups.getKeyCount());
+    for (mget_future_slice_t& slice : futureSlices) {
+        vector_results_t sliceResults = getSliceResults(slice);
+        stageClock.lap(FetchStage::wait);
+        placeSliceResults(hashslotGroups, slice.keys, sliceResults, distinctResults);
+        stageClock.lap(FetchStage::collect);
+    }
+    futureSlices.clear();
+
+    alignResults(hashslotGroups, distinctResults, results);
+    stageClock.lap(FetchStage::collect);
+}
 
-    auto futuresMap = std::make_shared<mgetFutureResultMap>();
+mget_future_slices_t& RedisDataStore::issueCrossslotRedisMget(const HashslotKeyGroups& hashslotGroups) {
+    // Reused between requests so that issuing the slices does not allocate
+    // once the thread has seen its largest request
+    static thread_local mget_future_slices_t futureSlices;
+    futureSlices.clear();
 
     // Issue all MGET operations to Redis and collect Futures
-    for (const auto& group : hashslotGroups) {
-        // uint16_t hashslot = group.first;
-        vector_keys_t hashslotKeys = group.second;
-        redisMget(hashslotKeys, futuresMap);
+    size_t roundTrips = 0;
+    if (batchByNode_) {
+        roundTrips = nodeBatchedRedisMget(hashslotGroups, futureSlices);
     }
+    else {
+        for (const hashslot_key_group_t& group : hashslotGroups.getGroups()) {
+            redisMget(group.keys, futureSlices);
+        }
+        roundTrips = futureSlices.size();
+    }
+    getThreadFetchMetrics().addFetch(hashslotGroups.getKeyCount(), roundTrips);
 
-    // Iterate over Futures and map result data to keys
-    for (auto&& p : *futuresMap) {
-        std::shared_ptr<vector_keys_t> sliceKeys = std::make_shared<vector_keys_t>(p.first);
+    return futureSlices;
+}
+
+template <typename IssueGroup>
+size_t RedisDataStore::forEachNodeGroup(const HashslotKeyGroups& hashslotGroups, IssueGroup&& issueGroup) {
+    static thread_local node_connections_t connections;
+    static thread_local std::vector<std::pair<uint16_t, size_t>> groupNodes;
 
-        if (indexByHashtag) {
-            std::for_each(sliceKeys->begin(), sliceKeys->end(), [this](std::string& key) {
-                key = getFeatureIDFromKey(redisKeyPrefix_, redisKeySuffix_, key);
-            });
+    // Asynchronous replies cannot refresh the topology from the event loop,
+    // they flag it and the next request refreshes it
+    if (topologyStale_.exchange(false)) {
+        refreshClusterTopology(topologyEpoch_.load());
+    }
+
+    uint64_t epoch = topologyEpoch_.load();
+    size_t client = getThreadClientIndex();
+    if ((connections.generation != generation_) || (connections.client != client) || (connections.epoch != epoch)) {
+        connections.generation = generation_;
+        connections.client = client;
+        connections.epoch = epoch;
+        connections.topology = getClusterTopology();
+        connections.nodes.clear();
+        connections.nodes.resize(connections.topology->getNodeCount());
+    }
+    const ClusterTopology& topology = *connections.topology;
+
+    const std::vector<hashslot_key_group_t>& groups = hashslotGroups.getGroups();
+    groupNodes.clear();
+    for (size_t i = 0; i < groups.size(); i++) {
+        groupNodes.emplace_back(topology.getNodeForHashslot(groups[i].hashslot), i);
+    }
+    std::sort(groupNodes.begin(), groupNodes.end());
+
+    size_t roundTrips = 0;
+    for (size_t i = 0; i < groupNodes.size(); i++) {
+        auto [node, group] = groupNodes[i];
+        sw::redis::AsyncRedis* nodeConnection = nullptr;
+        if ((node != ClusterTopology::kUnassignedNode) && !topology.getNode(node).hashtag.empty()) {
+            if (connections.nodes[node] == nullptr) {
+                connections.nodes[node] = std::make_unique<sw::redis::AsyncRedis>(redisConnections_[client]->redis(topology.getNode(node).hashtag, true));
+            }
+            nodeConnection = connections.nodes[node].get();
+        }
+
+        size_t sliceCount = issueGroup(groups[group].keys, nodeConnection);
+        if (nodeConnection == nullptr) {
+            roundTrips += sliceCount;
+        }
+        else if ((i == 0) || (groupNodes[i - 1].first != node)) {
+            roundTrips++;
         }
+    }
+    return roundTrips;
+}
 
-        auto sliceResults = std::make_shared<vector_results_t>(p.second->get());
-        auto mappedSliceObjects = std::make_shared<multiget_result_map_t>();
+size_t RedisDataStore::nodeBatchedRedisMget(const HashslotKeyGroups& hashslotGroups, mget_future_slices_t& slices) {
+    return forEachNodeGroup(hashslotGroups, [this, &slices](std::span<const std::string_view> keys, sw::redis::AsyncRedis* nodeConnection) {
+        size_t slicesBefore = slices.size();
+        redisMget(keys, slices, nodeConnection);
+        return slices.size() - slicesBefore;
+    });
+}
 
-        zipResultObjects(sliceKeys, sliceResults, mappedSliceObjects);
-        results->merge(*mappedSliceObjects);
+vector_results_t RedisDataStore::getSliceResults(mget_future_slice_t& slice) {
+    vector_results_t sliceResults;
+    if (!slice.sentToNode) {
+        sliceResults = slice.future.get();
     }
+    else {
+        uint64_t epoch = topologyEpoch_.load();
+        try {
+            sliceResults = slice.future.get();
+        }
+        catch (sw::redis::RedirectionError& e) {
+            // MovedError or AskError: the slot has changed owner
+            refreshClusterTopology(epoch);
+            sliceResults = getThreadClient().mget<vector_results_t>(slice.keys.begin(), slice.keys.end()).get();
+        }
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - slice.issueTime);
+    getThreadFetchMetrics().addSlice(slice.keys.size(), latency.count());
+    return sliceResults;
+}
+
+/** Return the number of MGETs a group of keysCount keys is split into. */
+size_t RedisDataStore::getBatchSliceCount(size_t keysCount) const {
+    // If there is a maximum batch size defined, divide the keys into the
+    // fewest segments within the limit
+    if ((maxMultiKeyBatchCount_ > 0) && (keysCount > (size_t)maxMultiKeyBatchCount_)) {
+        return (keysCount + maxMultiKeyBatchCount_ - 1) / maxMultiKeyBatchCount_;
+    }
+    return 1;
 }
 
 /**
  * Perform an MGET operation against a Redis Cluster.
  * Precondition: all elements in keys hash to a single Redis hashslot.
- * This implementation returns a map of <std::string>:Future<OptionalString>
- * after using the Async Redis++ API. After all required redisMget calls
- * have been made, the caller should iterate over the futures to unpack
- * the result data.
+ * This implementation appends a span<keys>:Future<vector<OptionalString>>
+ * slice for every MGET issued using the Async Redis++ API. After all
+ * required redisMget calls have been made, the caller should iterate over
+ * the slices to unpack the result data.
  *
- * @param keys a vector of Redis keys that hash to a single Redis hashslot.
- * @param results a map of key:value pairs retrieved from Redis.
+ * @param keys Redis keys that hash to a single Redis hashslot.
+ * @param slices the pending MGET slices, one appended per MGET issued.
+ * @param nodeConnection connection to the node owning the hashslot, or nullptr.
  */
-void RedisDataStore::redisMget(vector_keys_t& keys, const std::shared_ptr<mgetFutureResultMap>& results) {
-    mgetFutureResultMap redisResults;
-    size_t keysCount = keys.size();
+void RedisDataStore::redisMget(std::span<const std::string_view> keys, mget_future_slices_t& slices, sw::redis::AsyncRedis* nodeConnection) {
+    forEachBatchSlice(keys, getBatchSliceCount(keys.size()), [this, &slices, nodeConnection](std::span<const std::string_view> sliceKeys) {
+        auto issueTime = std::chrono::steady_clock::now();
+        if (nodeConnection != nullptr) {
+            slices.push_back({sliceKeys, nodeConnection->mget<vector_results_t>(sliceKeys.begin(), sliceKeys.end()), true, issueTime});
+        }
+        else {
+            slices.push_back({sliceKeys, getThreadClient().mget<vector_results_t>(sliceKeys.begin(), sliceKeys.end()), false, issueTime});
+        }
+    });
+}
 
-    if (maxMultiKeyBatchCount_ > 0) {
-        // If there is a maximum batch size defined, divide sliceKeys into segments
-        // and issue multiple redis mget calls
-        for (size_t i = 0; i < keysCount; i += maxMultiKeyBatchCount_) {
-            size_t last = std::min(keysCount, i + maxMultiKeyBatchCount_);
-            vector_keys_t sliceKeys(keys.begin() + (long)i, keys.begin() + (long)last);
+/**
+ * State of a fetchByFeatureKeysAsync request, shared by the callbacks of
+ * its MGET slices. The last slice to complete runs the fetch callback.
+ */
+struct async_fetch_t {
+    HashslotKeyGroups hashslotGroups;
+    vector_results_t distinctResults;
+    std::atomic<size_t> pendingSlices = 0;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    fetch_callback_t callback;
+};
+
+static void setAsyncFetchError(async_fetch_t& fetch, std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(fetch.errorMutex);
+    if (fetch.error == nullptr) {
+        fetch.error = std::move(error);
+    }
+}
 
-            async_multiget_future_result_t tmpMgetFutures = redisConnection_->mget<vector_results_t>(sliceKeys.begin(), sliceKeys.end());
-            std::shared_ptr<async_multiget_future_result_t> futuresResults = std::make_shared<async_multiget_future_result_t>(
-                std::move(tmpMgetFutures));
-            vector_keys_t hashableKeys = vector_keys_t(keys);
+static void completeAsyncFetch(async_fetch_t& fetch) {
+    vector_results_t results;
+    alignResults(fetch.hashslotGroups, fetch.distinctResults, results);
+    try {
+        fetch.callback(results, fetch.error);
+    }
+    catch (std::exception& e) {
+        std::cerr << "error: fetchByFeatureKeysAsync callback threw: " << e.what() << std::endl;
+    }
+}
 
-            results->insert({keys, futuresResults});
+/**
+ * Count completed slices, completing the fetch when none remain.
+ */
+static void finishAsyncSlices(async_fetch_t& fetch, size_t sliceCount) {
+    if (fetch.pendingSlices.fetch_sub(sliceCount, std::memory_order_acq_rel) == sliceCount) {
+        completeAsyncFetch(fetch);
+    }
+}
+
+void RedisDataStore::asyncRedisMget(const std::shared_ptr<async_fetch_t>& fetch,
+                                    std::span<const std::string_view> sliceKeys,
+                                    sw::redis::AsyncRedis* nodeConnection) {
+    bool sentToNode = (nodeConnection != nullptr);
+    auto onReply = [this, fetch, sliceKeys, sentToNode](async_multiget_future_result_t&& future) {
+        try {
+            vector_results_t sliceResults = future.get();
+            placeSliceResults(fetch->hashslotGroups, sliceKeys, sliceResults, fetch->distinctResults);
+        }
+        catch (sw::redis::RedirectionError& e) {
+            if (!sentToNode) {
+                setAsyncFetchError(*fetch, std::current_exception());
+            }
+            else {
+                // MovedError or AskError: the slot has changed owner. Retry
+                // through the cluster client, which follows the redirection.
+                topologyStale_ = true;
+                try {
+                    asyncRedisMget(fetch, sliceKeys, nullptr);
+                    return;
+                }
+                catch (...) {
+                    setAsyncFetchError(*fetch, std::current_exception());
+                }
+            }
         }
+        catch (...) {
+            setAsyncFetchError(*fetch, std::current_exception());
+        }
+        finishAsyncSlices(*fetch, 1);
+    };
+
+    if (sentToNode) {
+        nodeConnection->mget<vector_results_t>(sliceKeys.begin(), sliceKeys.end(), std::move(onReply));
     }
     else {
-        async_multiget_future_result_t tmpMgetFutures = redisConnection_->mget<vector_results_t>(keys.begin(), keys.end());
-        std::shared_ptr<async_multiget_future_result_t> futuresResults = std::make_shared<async_multiget_future_result_t>(std::move(tmpMgetFutures));
-        vector_keys_t hashableKeys = vector_keys_t(keys);
+        getThreadClient().mget<vector_results_t>(sliceKeys.begin(), sliceKeys.end(), std::move(onReply));
+    }
+}
 
-        results->insert({keys, futuresResults});
+void RedisDataStore::fetchByFeatureKeysAsync(const vector_hashslot_keys_t& keys, fetch_callback_t callback) {
+    auto fetch = std::make_shared<async_fetch_t>();
+    fetch->callback = std::move(callback);
+    fetch->hashslotGroups.group(std::span<const hashslot_key_t>(keys));
+    fetch->distinctResults.resize(fetch->hashslotGroups.getKeyCount());
+
+    // Every slice is counted before any is issued, so a reply arriving
+    // while later slices are issued cannot complete the fetch early
+    size_t sliceCount = 0;
+    for (const hashslot_key_group_t& group : fetch->hashslotGroups.getGroups()) {
+        sliceCount += getBatchSliceCount(group.keys.size());
+    }
+    if (sliceCount == 0) {
+        completeAsyncFetch(*fetch);
+        return;
+    }
+    fetch->pendingSlices = sliceCount;
+
+    size_t issuedCount = 0;
+    auto issueGroup = [this, &fetch, &issuedCount](std::span<const std::string_view> groupKeys, sw::redis::AsyncRedis* nodeConnection) {
+        size_t groupSliceCount = getBatchSliceCount(groupKeys.size());
+        forEachBatchSlice(groupKeys, groupSliceCount, [this, &fetch, &issuedCount, nodeConnection](std::span<const std::string_view> sliceKeys) {
+            asyncRedisMget(fetch, sliceKeys, nodeConnection);
+            issuedCount++;
+        });
+        return groupSliceCount;
+    };
+
+    // Replies complete on the event loop threads, so asynchronous fetches
+    // are not recorded in the per-thread FetchMetrics
+    try {
+        if (batchByNode_) {
+            forEachNodeGroup(fetch->hashslotGroups, issueGroup);
+        }
+        else {
+            for (const hashslot_key_group_t& group : fetch->hashslotGroups.getGroups()) {
+                issueGroup(group.keys, nullptr);
+            }
+        }
+    }
+    catch (...) {
+        // Slices not issued will never reply, count them as complete
+        setAsyncFetchError(*fetch, std::current_exception());
+        finishAsyncSlices(*fetch, sliceCount - issuedCount);
     }
 }
 
-void RedisDataStore::fetchByFeatureKeys(vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag) {
-    hashslot_key_groups_t hashslotGroups;
+void RedisDataStore::fetchByFeatureKeys(const vector_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag) {
+    static thread_local vector_key_views_t keyViews;
+    keyViews.assign(keys.begin(), keys.end());
+    fetchByFeatureKeys(keyViews, results, indexByHashtag);
+}
 
-    // TODO: keys vector is mutated by this function. Measure impact of using a
-    // copy of the vector. (i.e. pass by copy rather than reference.)
-    // vector_keys_t localKeys = keys;
-    // removeDuplicates(localKeys);
+void RedisDataStore::fetchByFeatureKeys(const vector_key_views_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag) {
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    stageClock.start(timeFetchStages_);
+    HashslotKeyGroups& hashslotGroups = getThreadHashslotKeyGroups();
+    groupKeysByRedisHashslot(keys, hashslotGroups);
+    stageClock.lap(FetchStage::group);
 
-    removeDuplicates(keys);
+    crossslotRedisMget(hashslotGroups, results, indexByHashtag);
+    checkFetchResultCount(hashslotGroups.getKeyCount(), results);
+    stageClock.stop();
+}
 
-    size_t keysCount = keys.size();
-    std::shared_ptr<multiget_result_map_t> retrievedObjects = std::make_shared<multiget_result_map_t>();
-    retrievedObjects->reserve(keysCount);
+void RedisDataStore::fetchByFeatureKeys(const vector_hashslot_keys_t& keys, const std::shared_ptr<multiget_result_map_t>& results, bool indexByHashtag) {
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    stageClock.start(timeFetchStages_);
+    HashslotKeyGroups& hashslotGroups = getThreadHashslotKeyGroups();
+    groupKeysByRedisHashslot(keys, hashslotGroups);
+    stageClock.lap(FetchStage::group);
+
+    crossslotRedisMget(hashslotGroups, results, indexByHashtag);
+    checkFetchResultCount(hashslotGroups.getKeyCount(), results);
+    stageClock.stop();
+}
 
-    crossslotRedisMget(keys, results, indexByHashtag);
+void RedisDataStore::fetchByFeatureKeys(const vector_key_views_t& keys, vector_results_t& results) {
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    stageClock.start(timeFetchStages_);
+    HashslotKeyGroups& hashslotGroups = getThreadHashslotKeyGroups();
+    groupKeysByRedisHashslot(keys, hashslotGroups);
+    stageClock.lap(FetchStage::group);
+
+    crossslotRedisMget(hashslotGroups, results);
+    stageClock.stop();
+}
 
+void RedisDataStore::fetchByFeatureKeys(const vector_hashslot_keys_t& keys, vector_results_t& results) {
+    FetchStageClock& stageClock = getThreadFetchStageClock();
+    stageClock.start(timeFetchStages_);
+    HashslotKeyGroups& hashslotGroups = getThreadHashslotKeyGroups();
+    groupKeysByRedisHashslot(keys, hashslotGroups);
+    stageClock.lap(FetchStage::group);
+
+    crossslotRedisMget(hashslotGroups, results);
+    stageClock.stop();
+}
+
+void RedisDataStore::checkFetchResultCount(size_t keysCount, const std::shared_ptr<multiget_result_map_t>& results) {
     size_t resultCount = results->size();
     if (resultCount != keysCount) {
         std::string message =
@@ -387,8 +859,4 @@ std::string RedisDataStore::getDatasetVersion() {
     return this->getDatasetVersionFromDatasetMeta(metaString);
 }
 
-//void RedisDataStore::getClusterSlots() {
-//    issueSynchronousRedisArrayCommand({"CLUSTER", "INFO"});
-//}
-
 }  // namespace redis_store
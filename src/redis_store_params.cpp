@@ -1,37 +1,206 @@
+#include <redis_workload/cpu_affinity.h>
 #include <redis_workload/redis_store_exceptions.h>
 #include <redis_workload/redis_store_params.h>
 
+#include <fstream>
 #include <string>
+#include <vector>
 
 namespace redis_store {
 
 // TODO: Add validation checks for all config values
 bool RedisStoreParams::valid() const {
     if (redisHost.empty()) {
-        throw ConfigParamError("config error: " + kConfigRedisClusterHost);
+        throw ConfigParamError("config error: host not set");
     }
 
     if (redisUser.empty()) {
-        throw ConfigParamError("config error: " + kConfigRedisClusterUser);
+        throw ConfigParamError("config error: user not set");
     }
 
     if (redisPassword.empty()) {
-        throw ConfigParamError("config error: " + kConfigRedisClusterPassword + " not set");
+        throw ConfigParamError("config error: password not set");
     }
 
     if (redisKeyPrefix.empty()) {
-        throw ConfigParamError("config error: " + redisKeyPrefix);
+        throw ConfigParamError("config error: key_prefix not set");
     }
 
     if (redisKeySuffix.empty()) {
-        throw ConfigParamError("config error: " + redisKeySuffix);
+        throw ConfigParamError("config error: key_suffix not set");
     }
 
     if (redisPort <= Min_Port_Number_) {
-        throw ConfigParamError("config error: " + kConfigRedisClusterPort);
+        throw ConfigParamError("config error: port must be above " + std::to_string(Min_Port_Number_));
     }
 
     return true;
 }
 
+static int parseIntField(const std::string& name, const std::string& value) {
+    size_t parsed = 0;
+    int result = 0;
+    try {
+        result = std::stoi(value, &parsed);
+    }
+    catch (std::logic_error& e) {
+        parsed = 0;
+    }
+    if ((parsed == 0) || (parsed != value.size())) {
+        throw ConfigParamError("config error: " + name + " must be an integer, not " + value);
+    }
+    return result;
+}
+
+static bool parseBoolField(const std::string& name, const std::string& value) {
+    if ((value == "true") || (value == "1")) {
+        return true;
+    }
+    if ((value == "false") || (value == "0")) {
+        return false;
+    }
+    throw ConfigParamError("config error: " + name + " must be true or false, not " + value);
+}
+
+const std::vector<std::string>& RedisStoreParams::getFieldNames() {
+    static const std::vector<std::string> kFieldNames = {"host",
+                                                         "port",
+                                                         "user",
+                                                         "password",
+                                                         "key_prefix",
+                                                         "key_suffix",
+                                                         "prefer_read_replicas",
+                                                         "pool_size",
+                                                         "pool_wait_timeout",
+                                                         "pool_connection_lifetime",
+                                                         "pool_connection_max_idle",
+                                                         "max_multi_key_batch_size",
+                                                         "batch_by_node",
+                                                         "time_fetch_stages",
+                                                         "cluster_clients",
+                                                         "cluster_client_cpus"};
+    return kFieldNames;
+}
+
+void RedisStoreParams::set(const std::string& name, const std::string& value) {
+    if (name == "host") {
+        redisHost = value;
+    }
+    else if (name == "port") {
+        redisPort = parseIntField(name, value);
+    }
+    else if (name == "user") {
+        redisUser = value;
+    }
+    else if (name == "password") {
+        redisPassword = value;
+    }
+    else if (name == "key_prefix") {
+        redisKeyPrefix = value;
+    }
+    else if (name == "key_suffix") {
+        redisKeySuffix = value;
+    }
+    else if (name == "prefer_read_replicas") {
+        preferReadReplicas = parseBoolField(name, value);
+    }
+    else if (name == "pool_size") {
+        poolSize = parseIntField(name, value);
+        if (poolSize < 1) {
+            throw ConfigParamError("config error: " + name + " must be at least 1");
+        }
+    }
+    else if (name == "pool_wait_timeout") {
+        poolWaitTimeout = parseIntField(name, value);
+    }
+    else if (name == "pool_connection_lifetime") {
+        poolConnectionLifetime = parseIntField(name, value);
+    }
+    else if (name == "pool_connection_max_idle") {
+        poolConnectionMaxIdle = parseIntField(name, value);
+    }
+    else if (name == "max_multi_key_batch_size") {
+        maxMultiKeyBatchSize = parseIntField(name, value);
+        if (maxMultiKeyBatchSize < 1) {
+            throw ConfigParamError("config error: " + name + " must be at least 1");
+        }
+    }
+    else if (name == "batch_by_node") {
+        batchByNode = parseBoolField(name, value);
+    }
+    else if (name == "time_fetch_stages") {
+        timeFetchStages = parseBoolField(name, value);
+    }
+    else if (name == "cluster_clients") {
+        clusterClients = parseIntField(name, value);
+        if (clusterClients < 1) {
+            throw ConfigParamError("config error: " + name + " must be at least 1");
+        }
+    }
+    else if (name == "cluster_client_cpus") {
+        try {
+            if (!value.empty()) {
+                parseCpuPlacement(value);
+            }
+        }
+        catch (std::invalid_argument& e) {
+            throw ConfigParamError("config error: " + name + ": " + e.what());
+        }
+        clusterClientCpus = value;
+    }
+    else {
+        throw ConfigParamError("config error: unknown store parameter " + name);
+    }
+}
+
+void RedisStoreParams::loadConfigFile(const std::string& filename) {
+    std::ifstream input(filename);
+    if (!input) {
+        throw ConfigParamError("config error: could not open " + filename);
+    }
+
+    Json::CharReaderBuilder builder;
+    Json::Value config;
+    std::string errors;
+    if (!Json::parseFromStream(builder, input, &config, &errors) || !config.isObject()) {
+        throw ConfigParamError("config error: " + filename + " is not a JSON object: " + errors);
+    }
+
+    for (const auto& name : config.getMemberNames()) {
+        const Json::Value& value = config[name];
+        if (value.isBool()) {
+            set(name, value.asBool() ? "true" : "false");
+        }
+        else if (value.isString()) {
+            set(name, value.asString());
+        }
+        else if (value.isIntegral()) {
+            set(name, std::to_string(value.asInt64()));
+        }
+        else {
+            throw ConfigParamError("config error: " + name + " in " + filename + " is not a string, integer or boolean");
+        }
+    }
+}
+
+Json::Value RedisStoreParams::toJson() const {
+    Json::Value params;
+    params["host"] = redisHost;
+    params["port"] = redisPort;
+    params["user"] = redisUser;
+    params["key_prefix"] = redisKeyPrefix;
+    params["key_suffix"] = redisKeySuffix;
+    params["prefer_read_replicas"] = preferReadReplicas;
+    params["pool_size"] = poolSize;
+    params["pool_wait_timeout"] = poolWaitTimeout;
+    params["pool_connection_lifetime"] = poolConnectionLifetime;
+    params["pool_connection_max_idle"] = poolConnectionMaxIdle;
+    params["max_multi_key_batch_size"] = maxMultiKeyBatchSize;
+    params["batch_by_node"] = batchByNode;
+    params["time_fetch_stages"] = timeFetchStages;
+    params["cluster_clients"] = clusterClients;
+    params["cluster_client_cpus"] = clusterClientCpus;
+    return params;
+}
+
 }  // namespace redis_store
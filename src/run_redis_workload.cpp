@@ -1,40 +1,332 @@
 #include <getopt.h>
+#include <json/json.h>
+#include <redis_workload/capacity_search.h>
+#include <redis_workload/cpu_affinity.h>
+#include <redis_workload/interval_reporter.h>
 #include <redis_workload/query_runner.h>
 #include <redis_workload/redis_store.h>
+#include <redis_workload/redis_store_exceptions.h>
 #include <redis_workload/run_redis_workload.h>
+#include <redis_workload/run_results.h>
 #include <redis_workload/util.h>
+#include <redis_workload/worker_group.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 
 #include <boost/thread.hpp>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <redis_workload/remove_duplicates.hpp>
+#include <sstream>
 #include <string>
 #include <vector>
 
 using redis_store::bool_to_string;
-using redis_store::findAverage;
-using redis_store::findPercentile;
 using redis_store::RedisDataStore;
 using redis_store::removeDuplicates;
 
+using query_runner::ArrivalDistribution;
+using query_runner::capacity_probe_t;
+using query_runner::CapacitySearch;
 using query_runner::OperationMode;
+using query_runner::QueryDispatcher;
 using query_runner::QueryListCollector;
 using query_runner::QueryRunner;
+using query_runner::ResultApi;
+using query_runner::RunResults;
+using query_runner::StartGate;
+using query_runner::WorkerGroup;
 
 inline bool fileExists(const std::string& filename) {
     struct stat buffer;
     return (stat(filename.c_str(), &buffer) == 0);
 }
 
-void doTestRun(std::string& testName, unsigned int threadCount, QueryListCollector& collector, std::shared_ptr<RedisDataStore>& dataStore) {
-    std::vector<QueryRunner*> runners;
+/**
+ * Parse an integer command line argument, exiting with an error message
+ * if it is not a number.
+ */
+inline int parseIntArgument(const char* argument, const std::string& description) {
+    try {
+        return std::stoi(argument);
+    }
+    catch (std::logic_error& e) {
+        std::cerr << "error: " << description << " argument invalid" << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * Parse a floating point command line argument, exiting with an error
+ * message if it is not a number.
+ */
+inline double parseDoubleArgument(const char* argument, const std::string& description) {
+    try {
+        return std::stod(argument);
+    }
+    catch (std::logic_error& e) {
+        std::cerr << "error: " << description << " argument invalid" << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * Open-loop load settings, a rate of 0 runs closed loop.
+ */
+struct OpenLoopOptions {
+    double rate = 0.0;
+    ArrivalDistribution distribution = ArrivalDistribution::fixed;
+};
+
+/**
+ * Query issue settings shared by all runners.
+ */
+struct RunnerOptions {
+    ResultApi resultApi = ResultApi::map;
+    // Queries in flight per runner with the asynchronous API, 0 for blocking fetches
+    unsigned int maxInflight = 0;
+    // Coroutine clients for the process, spread over the runners, 0 runs
+    // each runner's queries on its own thread
+    unsigned int virtualClients = 0;
+    // Threads resuming the virtual clients, 0 for one per hardware thread
+    unsigned int executorThreads = 0;
+    // Queries claimed at a time from the shared dispatcher in dynamic mode
+    unsigned int dispatchChunkSize = 16;
+    OpenLoopOptions openLoop;
+    // Position of this process among every process and worker of the test,
+    // so the arrival schedules of their runners differ
+    unsigned int processIndex = 0;
+    unsigned int processCount = 1;
+    // Replay the logged query times sped up by this factor, 0 to ignore them
+    double replaySpeedup = 0.0;
+    // Seconds between live interval reports, 0 for none
+    double intervalSeconds = 0.0;
+    // CSV or JSON lines file the interval reports are appended to
+    std::string intervalFile;
+    // Cycle through the queries for this many seconds, 0 runs each query once
+    double durationSeconds = 0.0;
+    // Cycle through the queries until the process has sent this many, 0
+    // runs each query once
+    size_t queryLimit = 0;
+    // CPU sets the runner threads are pinned to in turn, empty for unpinned
+    std::vector<std::vector<int>> runnerCpus;
+};
+
+/**
+ * The runs of a test: an optional warmup, left out of the results, then
+ * the measured iterations.
+ */
+struct TestPlan {
+    // Warmup bounded by a duration or by a number of queries, 0 for none
+    double warmupSeconds = 0.0;
+    size_t warmupQueries = 0;
+    unsigned int iterations = 2;
+};
+
+/**
+ * Capacity search settings: the load ramped and bisected, and the p99 it
+ * must stay within.
+ */
+struct SearchOptions {
+    // "threads" or "rate", empty for no search
+    std::string load;
+    long long p99SloMicro = 0;
+    // Highest thread count or rate run, 0 for the default of the load
+    double maxLoad = 0.0;
+    // Width of the final rate range, as a percentage of the rate
+    double precisionPercent = 5.0;
+};
+
+/**
+ * One store parameter varied by a sweep, by its config name.
+ */
+struct SweepParameter {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+/**
+ * Describe the settings of the test as JSON for the results file. The
+ * password is left out.
+ */
+Json::Value makeConfigJson(const std::string& datafileName,
+                           unsigned int threadCount,
+                           OperationMode mode,
+                           int processIndex,
+                           int processCount,
+                           const redis_store::RedisStoreParams& storeParams,
+                           const RunnerOptions& options) {
+    Json::Value config;
+    config["datafile"] = datafileName;
+    config["threads"] = threadCount;
+    switch (mode) {
+        case OperationMode::divide:
+            config["mode"] = "divide";
+            break;
+        case OperationMode::replicate:
+            config["mode"] = "replicate";
+            break;
+        case OperationMode::dynamic:
+            config["mode"] = "dynamic";
+            config["dispatch_chunk_size"] = options.dispatchChunkSize;
+            break;
+    }
+    config["process_index"] = processIndex;
+    config["process_count"] = processCount;
+
+    if (options.virtualClients > 0) {
+        config["result_api"] = "async";
+        config["virtual_clients"] = options.virtualClients;
+        config["executor_threads"] = options.executorThreads;
+    }
+    else if (options.maxInflight > 0) {
+        config["result_api"] = "async";
+        config["inflight"] = options.maxInflight;
+    }
+    else {
+        config["result_api"] = query_runner::resultApiToString(options.resultApi);
+    }
+    config["open_loop_rate"] = options.openLoop.rate;
+    if (options.openLoop.rate > 0.0) {
+        config["arrival_distribution"] = query_runner::arrivalDistributionToString(options.openLoop.distribution);
+    }
+    config["replay_speedup"] = options.replaySpeedup;
+    config["duration_seconds"] = options.durationSeconds;
+
+    config["store"] = storeParams.toJson();
+    return config;
+}
+
+static std::shared_ptr<query_runner::CoroutineExecutor> processExecutor;
+
+/**
+ * Return the executor of the virtual clients, created on first use and
+ * shared by every run of the process, so the warmup, iterations and
+ * probes do not each start a set of executor threads. A worker process
+ * creates its own after the fork.
+ *
+ * @param executorThreads the executor threads, 0 for one per core
+ */
+std::shared_ptr<query_runner::CoroutineExecutor> getProcessExecutor(unsigned int executorThreads) {
+    if (processExecutor == nullptr) {
+        processExecutor = std::make_shared<query_runner::CoroutineExecutor>(executorThreads);
+    }
+    return processExecutor;
+}
+
+/**
+ * Stop the executor threads once the runs using it are done. Their
+ * per-thread node connections hold the event loops and pools of the
+ * store they last used, so they are stopped along with the store.
+ */
+void releaseProcessExecutor() {
+    processExecutor = nullptr;
+}
+
+/**
+ * Run the workload once with a fresh set of runners and print the reports.
+ * The runners start together once all of them are ready, and in a worker
+ * process once the runners of every worker are ready.
+ *
+ * @param workers the worker group of this worker process, null when not
+ *        running as a worker
+ * @return the results of the run, for the JSON results file
+ */
+Json::Value doTestRun(std::string& testName,
+                      unsigned int threadCount,
+                      QueryListCollector& collector,
+                      std::shared_ptr<RedisDataStore>& dataStore,
+                      const RunnerOptions& options,
+                      WorkerGroup* workers) {
+    std::shared_ptr<query_runner::CoroutineExecutor> executor;
+    unsigned int clientsPerRunner = 0;
+    if (options.virtualClients > 0) {
+        executor = getProcessExecutor(options.executorThreads);
+        clientsPerRunner = (options.virtualClients + threadCount - 1) / threadCount;
+        std::cout << "Running " << std::to_string(clientsPerRunner * threadCount) << " virtual clients on "
+                  << std::to_string(executor->getThreadCount()) << " executor threads" << std::endl;
+    }
+
+    // A fresh dispatcher for every run, so each run covers the whole bucket
+    auto duration = std::chrono::milliseconds((long long)(options.durationSeconds * 1000.0));
+    std::shared_ptr<QueryDispatcher> dispatcher;
+    if (collector.getMode() == OperationMode::dynamic) {
+        bool cycle = (duration.count() > 0) || (options.queryLimit > 0);
+        dispatcher = std::make_shared<QueryDispatcher>(collector.getBucket(0).size(), options.dispatchChunkSize, cycle);
+    }
+
+    struct rusage usageBefore {};
+    getrusage(RUSAGE_SELF, &usageBefore);
+
+    // Owned by the run, so the store and executor they share are released
+    // once the run is reported
+    std::vector<std::unique_ptr<QueryRunner>> runners;
     runners.reserve(threadCount);
     for (unsigned int i = 0; i < threadCount; i++) {
-        runners[i] = new QueryRunner(testName, i, dataStore, collector.getBucket(i));
+        runners.emplace_back(std::make_unique<QueryRunner>(testName, i, dataStore, collector.getBucket(i)));
+        runners[i]->setResultApi(options.resultApi);
+        runners[i]->setMaxInflight(options.maxInflight);
+        runners[i]->setDispatcher(dispatcher);
+        if (executor != nullptr) {
+            runners[i]->setVirtualClients(clientsPerRunner, executor);
+        }
+        if (options.openLoop.rate > 0.0) {
+            // Every runner sends an equal share of the process rate, on a
+            // schedule seeded and phased by its place among the runners of
+            // every process
+            runners[i]->setOpenLoop(options.openLoop.rate / threadCount,
+                                    options.openLoop.distribution,
+                                    (options.processIndex * threadCount) + i,
+                                    options.processCount * threadCount);
+        }
+        runners[i]->setReplay(options.replaySpeedup);
+        runners[i]->setDuration(duration);
+        if (!options.runnerCpus.empty()) {
+            // The runners of every worker take consecutive CPU sets. Divided
+            // buckets are copied to the runner's node, dynamic dispatch and
+            // replicated buckets keep reading the shared workload.
+            size_t slot = ((workers != nullptr) ? (size_t)workers->getWorkerIndex() * threadCount : 0) + i;
+            runners[i]->setCpuAffinity(options.runnerCpus[slot % options.runnerCpus.size()], collector.getMode() == OperationMode::divide);
+        }
+    }
+
+    // Only the runners with queries are spawned and wait at the gate
+    unsigned int readyCount = 0;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        readyCount += runners[i]->readyToRun() ? 1 : 0;
+    }
+    auto startGate = std::make_shared<StartGate>(readyCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        runners[i]->setStartGate(startGate);
+        if ((options.queryLimit > 0) && (readyCount > 0)) {
+            runners[i]->setQueryLimit((options.queryLimit + readyCount - 1) / readyCount);
+        }
     }
 
     std::cout << "All runners initialized" << std::endl;
 
+    std::unique_ptr<query_runner::IntervalReporter> intervalReporter;
+    if (options.intervalSeconds > 0.0) {
+        std::vector<std::shared_ptr<query_runner::IntervalRecorder>> recorders;
+        for (unsigned int i = 0; i < threadCount; i++) {
+            recorders.push_back(std::make_shared<query_runner::IntervalRecorder>());
+            runners[i]->setIntervalRecorder(recorders.back());
+        }
+        auto interval = std::chrono::milliseconds((long long)(options.intervalSeconds * 1000.0));
+        // The workers append to the same interval file
+        std::string intervalName = (workers != nullptr) ? testName + ".worker" + std::to_string(workers->getWorkerIndex()) : testName;
+        try {
+            intervalReporter = std::make_unique<query_runner::IntervalReporter>(intervalName, recorders, interval, options.intervalFile);
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << std::endl;
+            exit(1);
+        }
+    }
+
     std::vector<boost::thread> threads;
     threads.reserve(threadCount);
     for (unsigned int i = 0; i < threadCount; i++) {
@@ -47,23 +339,105 @@ void doTestRun(std::string& testName, unsigned int threadCount, QueryListCollect
     std::cout << std::endl;
     std::cout << "All runners spawned" << std::endl;
 
+    // Release the runners together, once the other workers are ready too
+    startGate->waitForRunners();
+    if (workers != nullptr) {
+        workers->arriveAndWait();
+    }
+    auto startTime = startGate->release();
+    if (intervalReporter != nullptr) {
+        intervalReporter->start();
+    }
+
     for (auto& t : threads) {
         t.join();
     }
+    auto runtime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    if (intervalReporter != nullptr) {
+        intervalReporter->stop();
+    }
 
     std::cout << std::endl;
     std::cout << "All runners complete" << std::endl;
 
+    struct rusage usageAfter {};
+    getrusage(RUSAGE_SELF, &usageAfter);
+    std::cout << "Process context switches during " << testName << ": voluntary "
+              << std::to_string(usageAfter.ru_nvcsw - usageBefore.ru_nvcsw) << ", involuntary "
+              << std::to_string(usageAfter.ru_nivcsw - usageBefore.ru_nivcsw) << std::endl;
+    std::cout << "Process max resident set size: " << std::to_string(usageAfter.ru_maxrss) << " KB" << std::endl;
+
     std::cout << std::endl;
+    redis_store::FetchMetrics fetchMetrics;
+    redis_store::LatencyHistogram queryTimes;
+    redis_store::LatencyHistogram serviceTimes;
+    Json::Value runnerResults(Json::arrayValue);
+    Json::UInt64 queryCount = 0;
+    Json::UInt64 successCount = 0;
     for (unsigned int i = 0; i < threadCount; i++) {
         if (runners[i]->runComplete()) {
             std::cout << runners[i]->getReport();
+            fetchMetrics.merge(runners[i]->getFetchMetrics());
+            queryTimes.merge(runners[i]->getQueryTimes());
+            serviceTimes.merge(runners[i]->getServiceTimes());
+
+            Json::Value runnerResult = runners[i]->getResultJson();
+            queryCount += runnerResult["queries"].asUInt64();
+            successCount += runnerResult["successes"].asUInt64();
+            runnerResults.append(runnerResult);
         }
         else {
             std::cerr << "error: runner report " << std::to_string(i) << " not ready" << std::endl;
         }
         std::cout << std::endl;
     }
+
+    std::cout << "Fetch metrics for all runners of " << testName << ":" << std::endl;
+    std::cout << fetchMetrics.toString("  ") << std::endl;
+
+    std::cout << "Query times for all runners of " << testName << ": " << std::to_string(queryTimes.getTotalCount()) << " queries, mean "
+              << std::to_string(queryTimes.getMean()) << " microseconds" << std::endl;
+    std::cout << queryTimes.toString("      ", testName + " query times");
+    if (serviceTimes.getTotalCount() > 0) {
+        std::cout << serviceTimes.toString("      ", testName + " service times");
+    }
+    // Merged with the histograms of other processes to give cluster wide percentiles
+    std::cout << "  Serialized query time histogram: " << queryTimes.serialize() << std::endl;
+    std::cout << std::endl;
+
+    Json::Value result;
+    result["name"] = testName;
+    result["runtime_ms"] = (Json::Int64)runtime.count();
+    result["queries"] = queryCount;
+    result["successes"] = successCount;
+    result["queries_per_second"] = (runtime.count() > 0) ? ((double)queryCount * 1000.0 / (double)runtime.count()) : 0.0;
+    result["context_switches_voluntary"] = (Json::Int64)(usageAfter.ru_nvcsw - usageBefore.ru_nvcsw);
+    result["context_switches_involuntary"] = (Json::Int64)(usageAfter.ru_nivcsw - usageBefore.ru_nivcsw);
+    result["max_rss_kb"] = (Json::Int64)usageAfter.ru_maxrss;
+    result["query_times"] = queryTimes.toJson();
+    if (serviceTimes.getTotalCount() > 0) {
+        result["service_times"] = serviceTimes.toJson();
+    }
+    result["runners"] = runnerResults;
+    return result;
+}
+
+/**
+ * Write the results file read by aggregate_results.
+ */
+void writeResultsJson(const std::string& filename, const Json::Value& results) {
+    std::ofstream output(filename);
+    if (!output) {
+        std::cerr << "error: could not open results file: " << filename << std::endl;
+        exit(1);
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    output << Json::writeString(builder, results) << std::endl;
+    if (!output) {
+        std::cerr << "error: could not write results file: " << filename << std::endl;
+        exit(1);
+    }
 }
 
 void usage(const std::string& appName) {
@@ -76,31 +450,442 @@ void usage(const std::string& appName) {
     std::cout << "usage: " << appName << " -t <n> -f <data.csv>" << std::endl;
     std::cout << "where:" << std::endl;
     std::cout << "    -t <n>           number of threads to use" << std::endl;
-    std::cout << "    -f <filename>    data file to use (csv format)" << std::endl;
+    std::cout << "    -f <filename>    data file to use (csv or compiled binary workload format)" << std::endl;
     std::cout << "    -r               replicate the data across threads (instead of dividing the data)" << std::endl;
+    std::cout << "    -D <dispatch>    static (default) assigns each thread its share of the queries before the run," << std::endl
+              << "                     dynamic lets the threads claim chunks of queries as they go" << std::endl;
+    std::cout << "    -k <n>           number of queries claimed at a time with dynamic dispatch (default 16)" << std::endl;
+    std::cout << "    -j <n>           number of threads used to parse the data file (default 1)" << std::endl;
+    std::cout << "    -s <name>        share one read-only copy of the workload between processes through the" << std::endl
+              << "                     named shared memory segment, the first process to start loads the data file" << std::endl;
+    std::cout << "    -i <index>       index of this process, from 0, when the workload is split across processes" << std::endl;
+    std::cout << "    -n <n>           number of processes the workload is split across (default 1)" << std::endl;
+    std::cout << "    -b               batch the MGETs of each query by cluster node, pipelining each node's MGETs" << std::endl
+              << "                     on one connection" << std::endl;
+    std::cout << "    -l               time the stages of each blocking fetch and report each stage's share of the" << std::endl
+              << "                     fetch time" << std::endl;
+    std::cout << "    -a <api>         result collection: map (key indexed map, default) or vector (aligned with" << std::endl
+              << "                     the query keys)" << std::endl;
+    std::cout << "    -q <qps>         send queries open loop at a total rate of qps queries/second for this process," << std::endl
+              << "                     timing each query from its scheduled send time (default: closed loop)" << std::endl;
+    std::cout << "    -d <dist>        open loop arrival distribution: fixed (default) or poisson" << std::endl;
+    std::cout << "    -T               the first column of the csv data file is the time each query was sent, in seconds" << std::endl
+              << "                     since the epoch with an optional fraction" << std::endl;
+    std::cout << "    -R <speedup>     replay the queries at their logged times, sped up by the given factor (1 for the" << std::endl
+              << "                     logged pace), each query is timed from its scheduled send time" << std::endl;
+    std::cout << "    -o <n>           use the asynchronous fetch API, keeping up to n queries in flight per thread" << std::endl;
+    std::cout << "    -c <n>           run n virtual clients, coroutines each sending one query at a time, spread over" << std::endl
+              << "                     the -t runners, closed loop, so not combined with -q or -o" << std::endl;
+    std::cout << "    -e <n>           number of executor threads running the virtual clients (default: one per core)" << std::endl;
+    std::cout << "    -I <seconds>     print throughput and latency of the last interval every n seconds while running" << std::endl;
+    std::cout << "    -O <filename>    also append the interval reports to a csv file, or json lines for a .json file" << std::endl;
+    std::cout << "    -J <filename>    write the configuration and results of the runs, with serialized histograms, to a" << std::endl
+              << "                     json file that aggregate_results can combine across processes" << std::endl;
+    std::cout << "    -u <seconds>     run for a fixed time, every runner cycling through its queries until the deadline" << std::endl;
+    std::cout << "    -p <n>           fork n worker processes, each with its own redis connections and its own slice of" << std::endl
+              << "                     the workload, starting every run together and merging their results in one report" << std::endl;
+    std::cout << "    -W <seconds>     warm up for the given time before the measured runs, the warmup is left out of" << std::endl
+              << "                     the results" << std::endl;
+    std::cout << "    -w <n>           warm up with n queries before the measured runs instead" << std::endl;
+    std::cout << "    -N <n>           number of measured runs (default 2), summarized with their mean, standard" << std::endl
+              << "                     deviation and 95% confidence interval" << std::endl;
+    std::cout << "    -S <load>        search for the capacity instead: ramp threads (from -t) or rate (open loop, from" << std::endl
+              << "                     -q or 1000 queries/second) and bisect to the highest load with p99 within -L" << std::endl;
+    std::cout << "    -L <micros>      the p99 query time SLO of the capacity search, in microseconds" << std::endl;
+    std::cout << "    -M <n>           the highest thread count or rate the search runs (default 1024 threads or" << std::endl
+              << "                     1000000 queries/second)" << std::endl;
+    std::cout << "    -P <percent>     stop bisecting the rate once the range is within this percentage (default 5)" << std::endl;
+    std::cout << "    -C <filename>    read redis store parameters from a json config file of parameter names and values" << std::endl;
+    std::cout << "    -x <name=value>  set a redis store parameter, after the config file, may be repeated" << std::endl;
+    std::cout << "    -X <name=v1,v2>  sweep a redis store parameter over the listed values, may be repeated to run every" << std::endl
+              << "                     combination, and print a table comparing them" << std::endl;
+    std::cout << "    -G <n>           create n independent cluster clients, each with its own event loop thread and" << std::endl
+              << "                     connection pool, and spread the runner threads over them (default 1)" << std::endl;
+    std::cout << "    -U <placement>   pin the event loop thread of each cluster client to one CPU of a CPU list, in turn," << std::endl
+              << "                     for example 0-3, or to the CPUs of one NUMA node of a node list, for example node:0,1" << std::endl;
+    std::cout << "    -K <placement>   pin each runner thread to one CPU or NUMA node of the placement, in turn, and" << std::endl
+              << "                     allocate its query copy and latency buffers on its node" << std::endl;
+    std::cout << "    -Y <placement>   pin each worker process of -p to one CPU or NUMA node of the placement, in turn" << std::endl;
+    std::cout << "    store parameters:";
+    for (const auto& name : redis_store::RedisStoreParams::getFieldNames()) {
+        std::cout << " " << name;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Run the warmup of the test plan, bounded by its duration or query count.
+ *
+ * @return the results of the warmup, flagged as a warmup
+ */
+Json::Value doWarmupRun(unsigned int threadCount,
+                        QueryListCollector& collector,
+                        std::shared_ptr<RedisDataStore>& dataStore,
+                        const RunnerOptions& runnerOptions,
+                        const TestPlan& plan,
+                        WorkerGroup* workers) {
+    RunnerOptions warmupOptions = runnerOptions;
+    warmupOptions.durationSeconds = plan.warmupSeconds;
+    warmupOptions.queryLimit = plan.warmupQueries;
+    std::string testName = "warmup";
+    Json::Value run = doTestRun(testName, threadCount, collector, dataStore, warmupOptions, workers);
+    run["warmup"] = true;
+    return run;
+}
+
+/**
+ * Run the tests in this process, or in one worker process.
+ *
+ * @param workers the worker group of this worker process, null when not
+ *        running as a worker
+ * @return the results of the runs
+ */
+Json::Value runTests(unsigned int threadCount,
+                     QueryListCollector& collector,
+                     const redis_store::RedisStoreParams& storeParams,
+                     const RunnerOptions& runnerOptions,
+                     const TestPlan& plan,
+                     WorkerGroup* workers) {
+    std::shared_ptr<RedisDataStore> redisStore = RedisDataStore::factory(storeParams);
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+
+    Json::Value runs(Json::arrayValue);
+    auto finishRun = [&](Json::Value run) {
+        if (workers != nullptr) {
+            workers->appendResult(Json::writeString(builder, run));
+        }
+        runs.append(run);
+        std::cout << std::endl;
+        std::cout << std::endl;
+    };
+
+    if ((plan.warmupSeconds > 0.0) || (plan.warmupQueries > 0)) {
+        finishRun(doWarmupRun(threadCount, collector, redisStore, runnerOptions, plan, workers));
+    }
+
+    for (unsigned int i = 1; i <= plan.iterations; i++) {
+        std::string testName = "run" + std::to_string(i);
+        finishRun(doTestRun(testName, threadCount, collector, redisStore, runnerOptions, workers));
+    }
+    return runs;
+}
+
+/**
+ * Run the test plan once for every combination of the swept store
+ * parameters, reconnecting to the cluster with the parameters of each,
+ * then print a table comparing the measured runs of the combinations.
+ *
+ * @param sweep the varied parameters, the last one varies fastest
+ * @param runs the measured runs of every combination are appended, named
+ *        after the combination
+ * @return one row per combination, for the JSON results file
+ */
+Json::Value runSweep(unsigned int threadCount,
+                     QueryListCollector& collector,
+                     const redis_store::RedisStoreParams& storeParams,
+                     const RunnerOptions& runnerOptions,
+                     const TestPlan& plan,
+                     const std::vector<SweepParameter>& sweep,
+                     Json::Value& runs) {
+    size_t combinationCount = 1;
+    for (const auto& parameter : sweep) {
+        combinationCount *= parameter.values.size();
+    }
+
+    Json::Value rows(Json::arrayValue);
+    std::vector<size_t> valueIndex(sweep.size(), 0);
+    for (size_t c = 0; c < combinationCount; c++) {
+        redis_store::RedisStoreParams params = storeParams;
+        Json::Value row;
+        std::string label;
+        for (size_t p = 0; p < sweep.size(); p++) {
+            const std::string& value = sweep[p].values[valueIndex[p]];
+            params.set(sweep[p].name, value);
+            row["params"][sweep[p].name] = value;
+            label += (p > 0 ? "," : "") + sweep[p].name + "=" + value;
+        }
+
+        std::cout << "Sweep combination " << std::to_string(c + 1) << " of " << std::to_string(combinationCount) << ": " << label << std::endl;
+        Json::Value combinationRuns = runTests(threadCount, collector, params, runnerOptions, plan, nullptr);
+        // Reconnect with the parameters of the next combination
+        releaseProcessExecutor();
+        redis_store::RedisDataStore::release();
+
+        std::vector<double> throughput;
+        std::vector<double> p50;
+        std::vector<double> p99;
+        for (auto& run : combinationRuns) {
+            if (run["warmup"].asBool()) {
+                continue;
+            }
+            throughput.push_back(run["queries_per_second"].asDouble());
+            p50.push_back(run["query_times"]["p50_us"].asDouble());
+            p99.push_back(run["query_times"]["p99_us"].asDouble());
+            run["name"] = label + " " + run["name"].asString();
+            run["sweep_params"] = row["params"];
+            runs.append(run);
+        }
+        row["queries_per_second"] = query_runner::iterationSummaryToJson(query_runner::summarizeIterations(throughput));
+        row["p50_us"] = query_runner::iterationSummaryToJson(query_runner::summarizeIterations(p50));
+        row["p99_us"] = query_runner::iterationSummaryToJson(query_runner::summarizeIterations(p99));
+        rows.append(row);
+
+        // Advance to the next combination, the last parameter fastest
+        for (size_t p = sweep.size(); p-- > 0;) {
+            if (++valueIndex[p] < sweep[p].values.size()) {
+                break;
+            }
+            valueIndex[p] = 0;
+        }
+    }
+
+    std::cout << "Sweep comparison, mean of " << std::to_string(plan.iterations) << " measured runs per combination:" << std::endl;
+    for (const auto& parameter : sweep) {
+        std::cout << std::left << std::setw((int)std::max<size_t>(parameter.name.size(), 8) + 2) << parameter.name;
+    }
+    std::cout << std::right << std::setw(16) << "queries/s" << std::setw(14) << "95% CI +/-" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+              << std::endl;
+    for (const auto& row : rows) {
+        for (const auto& parameter : sweep) {
+            std::cout << std::left << std::setw((int)std::max<size_t>(parameter.name.size(), 8) + 2) << row["params"][parameter.name].asString();
+        }
+        const Json::Value& throughput = row["queries_per_second"];
+        double confidence95 = (throughput["ci95_high"].asDouble() - throughput["ci95_low"].asDouble()) / 2;
+        std::cout << std::right << std::fixed << std::setprecision(1) << std::setw(16) << throughput["mean"].asDouble() << std::setw(14) << confidence95
+                  << std::setw(12) << row["p50_us"]["mean"].asDouble() << std::setw(12) << row["p99_us"]["mean"].asDouble() << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+    std::cout << std::endl;
+    return rows;
+}
+
+/**
+ * Ramp the thread count or open-loop rate and bisect to the highest load
+ * whose p99 query time is within the SLO, one run per load after the
+ * optional warmup. Prints the latency curve and the capacity.
+ *
+ * @param runs the results of the warmup and every probe run are appended
+ * @return the search results, for the JSON results file
+ */
+Json::Value runCapacitySearch(unsigned int threadCount,
+                              QueryListCollector& collector,
+                              const redis_store::RedisStoreParams& storeParams,
+                              const RunnerOptions& runnerOptions,
+                              const TestPlan& plan,
+                              const SearchOptions& searchOptions,
+                              Json::Value& runs) {
+    std::shared_ptr<RedisDataStore> redisStore = RedisDataStore::factory(storeParams);
+
+    if ((plan.warmupSeconds > 0.0) || (plan.warmupQueries > 0)) {
+        runs.append(doWarmupRun(threadCount, collector, redisStore, runnerOptions, plan, nullptr));
+        std::cout << std::endl;
+        std::cout << std::endl;
+    }
+
+    bool threadSearch = (searchOptions.load == "threads");
+    double startLoad = threadSearch ? (double)threadCount : runnerOptions.openLoop.rate;
+    CapacitySearch search(searchOptions.p99SloMicro, startLoad, searchOptions.maxLoad, threadSearch, searchOptions.precisionPercent / 100.0,
+                          searchOptions.load);
+
+    search.run([&](double load) {
+        RunnerOptions probeOptions = runnerOptions;
+        unsigned int probeThreads = threadCount;
+        std::string testName = "probe-" + searchOptions.load + "-";
+        if (threadSearch) {
+            probeThreads = (unsigned int)load;
+            collector.setBucketCount(probeThreads);
+            testName += std::to_string(probeThreads);
+        }
+        else {
+            probeOptions.openLoop.rate = load;
+            testName += std::to_string((long long)load);
+        }
+
+        Json::Value run = doTestRun(testName, probeThreads, collector, redisStore, probeOptions, nullptr);
+        run["search_" + searchOptions.load] = load;
+        runs.append(run);
+
+        capacity_probe_t probe;
+        probe.queriesPerSecond = run["queries_per_second"].asDouble();
+        probe.p50Micro = run["query_times"]["p50_us"].asInt64();
+        probe.p99Micro = run["query_times"]["p99_us"].asInt64();
+        std::cout << "Probe " << testName << ": " << std::to_string(probe.queriesPerSecond) << " queries/s, p99 " << std::to_string(probe.p99Micro)
+                  << " microseconds, " << ((probe.p99Micro <= searchOptions.p99SloMicro) ? "within" : "over") << " SLO" << std::endl;
+        std::cout << std::endl;
+        std::cout << std::endl;
+        return probe;
+    });
+
+    std::cout << search.toString() << std::endl;
+    return search.toJson();
+}
+
+/**
+ * Print the spread of the throughput and percentiles over the measured
+ * runs, to tell a change in the client or cluster from run to run noise.
+ *
+ * @param runs the results of the measured runs
+ * @return the summary for the JSON results file
+ */
+Json::Value printIterationSummary(const Json::Value& runs) {
+    std::vector<double> throughput;
+    std::vector<double> p50;
+    std::vector<double> p99;
+    for (const auto& run : runs) {
+        throughput.push_back(run["queries_per_second"].asDouble());
+        p50.push_back(run["query_times"]["p50_us"].asDouble());
+        p99.push_back(run["query_times"]["p99_us"].asDouble());
+    }
+
+    query_runner::iteration_summary_t throughputSummary = query_runner::summarizeIterations(throughput);
+    query_runner::iteration_summary_t p50Summary = query_runner::summarizeIterations(p50);
+    query_runner::iteration_summary_t p99Summary = query_runner::summarizeIterations(p99);
+
+    std::cout << "Summary of " << std::to_string(runs.size()) << " measured runs:" << std::endl;
+    std::cout << "  throughput: " << query_runner::iterationSummaryToString(throughputSummary, "queries/s") << std::endl;
+    std::cout << "  p50: " << query_runner::iterationSummaryToString(p50Summary, "microseconds") << std::endl;
+    std::cout << "  p99: " << query_runner::iterationSummaryToString(p99Summary, "microseconds") << std::endl;
+    std::cout << std::endl;
+
+    Json::Value summary;
+    summary["queries_per_second"] = query_runner::iterationSummaryToJson(throughputSummary);
+    summary["p50_us"] = query_runner::iterationSummaryToJson(p50Summary);
+    summary["p99_us"] = query_runner::iterationSummaryToJson(p99Summary);
+    return summary;
+}
+
+/**
+ * Print the merged report of every run of the worker processes.
+ *
+ * @return the merged results of the runs, each with the results of every
+ *         worker
+ */
+Json::Value mergeWorkerResults(WorkerGroup& workers) {
+    std::vector<RunResults> merged;
+    std::vector<Json::Value> workerRuns;
+    for (unsigned int w = 0; w < workers.getWorkerCount(); w++) {
+        std::vector<std::string> results = workers.getResults(w);
+        for (size_t r = 0; r < results.size(); r++) {
+            Json::Value runResult;
+            Json::CharReaderBuilder builder;
+            std::string errors;
+            std::stringstream input(results[r]);
+            if (!Json::parseFromStream(builder, input, &runResult, &errors)) {
+                throw std::runtime_error("Invalid results from worker " + std::to_string(w) + ": " + errors);
+            }
+            if (merged.size() <= r) {
+                merged.emplace_back(runResult["name"].asString());
+                workerRuns.emplace_back(Json::arrayValue);
+            }
+            runResult["worker"] = w;
+            merged[r].add(runResult);
+            workerRuns[r].append(runResult);
+        }
+    }
+
+    Json::Value runs(Json::arrayValue);
+    for (size_t r = 0; r < merged.size(); r++) {
+        std::cout << "Merged report for " << merged[r].getName() << " of " << std::to_string(workers.getWorkerCount()) << " worker processes:" << std::endl;
+        for (const auto& workerRun : workerRuns[r]) {
+            std::cout << "  worker " << workerRun["worker"].asString() << ": " << workerRun["queries"].asString() << " queries, "
+                      << std::to_string(workerRun["queries_per_second"].asDouble()) << " queries/s, p99 "
+                      << workerRun["query_times"]["p99_us"].asString() << " microseconds" << std::endl;
+        }
+        std::cout << merged[r].toString("  " + merged[r].getName());
+        std::cout << "  Serialized query time histogram: " << merged[r].getQueryTimes().serialize() << std::endl;
+        std::cout << std::endl;
+
+        Json::Value run = merged[r].toJson();
+        if (workerRuns[r][0]["warmup"].asBool()) {
+            run["warmup"] = true;
+        }
+        run["workers"] = workerRuns[r];
+        runs.append(run);
+    }
+    return runs;
 }
 
 int main(int argc, char* argv[]) {
     const std::string appName(basename(*argv));
 
     int threadCount = 0;
+    int parseThreadCount = 1;
+    int processIndex = 0;
+    int processCount = 1;
     std::string datafileName;
+    std::string sharedMemoryName;
     OperationMode mode = OperationMode::divide;
+    redis_store::RedisStoreParams storeParams;
+    RunnerOptions runnerOptions;
+    OpenLoopOptions& openLoop = runnerOptions.openLoop;
+    int maxInflight = 0;
+    int virtualClients = 0;
+    int executorThreads = 0;
+    bool dynamicDispatch = false;
+    int dispatchChunkSize = 16;
+    bool csvQueryTimes = false;
+    std::string resultsFileName;
+    int workerProcesses = 0;
+    TestPlan plan;
+    int iterations = 2;
+    long long warmupQueries = 0;
+    SearchOptions searchOptions;
+    std::string storeConfigFileName;
+    std::vector<std::pair<std::string, std::string>> storeSettings;
+    std::vector<SweepParameter> sweep;
+    std::string runnerPlacement;
+    std::string workerPlacement;
+    std::vector<std::vector<int>> workerCpus;
 
-    std::string argumentTemplate = "t:f:hr";
+    std::string argumentTemplate = "t:f:hrD:k:j:s:i:n:bla:q:d:TR:o:c:e:I:O:J:u:p:W:w:N:S:L:M:P:C:x:X:G:U:K:Y:";
+    const struct option longOptions[] = {{"threads", required_argument, nullptr, 't'},
+                                         {"file", required_argument, nullptr, 'f'},
+                                         {"replicate", no_argument, nullptr, 'r'},
+                                         {"dispatch", required_argument, nullptr, 'D'},
+                                         {"chunk-size", required_argument, nullptr, 'k'},
+                                         {"parse-threads", required_argument, nullptr, 'j'},
+                                         {"shm", required_argument, nullptr, 's'},
+                                         {"process-index", required_argument, nullptr, 'i'},
+                                         {"process-count", required_argument, nullptr, 'n'},
+                                         {"node-batching", no_argument, nullptr, 'b'},
+                                         {"stage-timing", no_argument, nullptr, 'l'},
+                                         {"result-api", required_argument, nullptr, 'a'},
+                                         {"rate", required_argument, nullptr, 'q'},
+                                         {"arrival", required_argument, nullptr, 'd'},
+                                         {"query-times", no_argument, nullptr, 'T'},
+                                         {"replay", required_argument, nullptr, 'R'},
+                                         {"inflight", required_argument, nullptr, 'o'},
+                                         {"clients", required_argument, nullptr, 'c'},
+                                         {"executor-threads", required_argument, nullptr, 'e'},
+                                         {"interval", required_argument, nullptr, 'I'},
+                                         {"interval-file", required_argument, nullptr, 'O'},
+                                         {"json", required_argument, nullptr, 'J'},
+                                         {"duration", required_argument, nullptr, 'u'},
+                                         {"processes", required_argument, nullptr, 'p'},
+                                         {"warmup", required_argument, nullptr, 'W'},
+                                         {"warmup-queries", required_argument, nullptr, 'w'},
+                                         {"iterations", required_argument, nullptr, 'N'},
+                                         {"search", required_argument, nullptr, 'S'},
+                                         {"slo", required_argument, nullptr, 'L'},
+                                         {"search-max", required_argument, nullptr, 'M'},
+                                         {"search-precision", required_argument, nullptr, 'P'},
+                                         {"store-config", required_argument, nullptr, 'C'},
+                                         {"store", required_argument, nullptr, 'x'},
+                                         {"sweep", required_argument, nullptr, 'X'},
+                                         {"cluster-clients", required_argument, nullptr, 'G'},
+                                         {"loop-cpus", required_argument, nullptr, 'U'},
+                                         {"runner-cpus", required_argument, nullptr, 'K'},
+                                         {"worker-cpus", required_argument, nullptr, 'Y'},
+                                         {"help", no_argument, nullptr, 'h'},
+                                         {nullptr, 0, nullptr, 0}};
 
-    // TODO: Add input datafile argument
     int ch;
-    while ((ch = getopt(argc, argv, argumentTemplate.c_str())) != -1) {
+    while ((ch = getopt_long(argc, argv, argumentTemplate.c_str(), longOptions, nullptr)) != -1) {
         switch (ch) {
             case 't':
-                try {
-                    threadCount = std::stoi(optarg);
-                }
-                catch (std::invalid_argument& e) {
-                    std::cerr << "error: thread count argument invalid" << std::endl;
-                    exit(1);
-                };
+                threadCount = parseIntArgument(optarg, "thread count");
                 break;
             case 'f':
                 datafileName = std::string(optarg);
@@ -108,6 +893,156 @@ int main(int argc, char* argv[]) {
             case 'r':
                 mode = OperationMode::replicate;
                 break;
+            case 'D':
+                if (std::string(optarg) == "dynamic") {
+                    dynamicDispatch = true;
+                }
+                else if (std::string(optarg) != "static") {
+                    std::cerr << "error: unknown dispatch mode: " << optarg << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'k':
+                dispatchChunkSize = parseIntArgument(optarg, "dispatch chunk size");
+                break;
+            case 'j':
+                parseThreadCount = parseIntArgument(optarg, "parse thread count");
+                break;
+            case 's':
+                sharedMemoryName = std::string(optarg);
+                if (sharedMemoryName.front() != '/') {
+                    sharedMemoryName.insert(0, "/");
+                }
+                break;
+            case 'i':
+                processIndex = parseIntArgument(optarg, "process index");
+                break;
+            case 'n':
+                processCount = parseIntArgument(optarg, "process count");
+                break;
+            case 'b':
+                storeSettings.emplace_back("batch_by_node", "true");
+                break;
+            case 'l':
+                storeSettings.emplace_back("time_fetch_stages", "true");
+                break;
+            case 'a':
+                try {
+                    runnerOptions.resultApi = query_runner::resultApiFromString(optarg);
+                }
+                catch (std::runtime_error& e) {
+                    std::cerr << "error: " << e.what() << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'q':
+                openLoop.rate = parseDoubleArgument(optarg, "rate");
+                break;
+            case 'T':
+                csvQueryTimes = true;
+                break;
+            case 'R':
+                runnerOptions.replaySpeedup = parseDoubleArgument(optarg, "replay speedup");
+                if (runnerOptions.replaySpeedup <= 0.0) {
+                    std::cerr << "error: replay speedup must be greater than 0" << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'o':
+                maxInflight = parseIntArgument(optarg, "inflight");
+                break;
+            case 'c':
+                virtualClients = parseIntArgument(optarg, "virtual client count");
+                break;
+            case 'e':
+                executorThreads = parseIntArgument(optarg, "executor thread count");
+                break;
+            case 'I':
+                runnerOptions.intervalSeconds = parseDoubleArgument(optarg, "interval");
+                break;
+            case 'O':
+                runnerOptions.intervalFile = std::string(optarg);
+                break;
+            case 'J':
+                resultsFileName = std::string(optarg);
+                break;
+            case 'u':
+                runnerOptions.durationSeconds = parseDoubleArgument(optarg, "duration");
+                break;
+            case 'p':
+                workerProcesses = parseIntArgument(optarg, "worker process count");
+                break;
+            case 'W':
+                plan.warmupSeconds = parseDoubleArgument(optarg, "warmup");
+                break;
+            case 'w':
+                warmupQueries = parseIntArgument(optarg, "warmup query count");
+                break;
+            case 'N':
+                iterations = parseIntArgument(optarg, "iteration count");
+                break;
+            case 'S':
+                searchOptions.load = std::string(optarg);
+                if ((searchOptions.load != "threads") && (searchOptions.load != "rate")) {
+                    std::cerr << "error: unknown search load: " << optarg << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'L':
+                searchOptions.p99SloMicro = parseIntArgument(optarg, "SLO");
+                break;
+            case 'M':
+                searchOptions.maxLoad = parseDoubleArgument(optarg, "search max");
+                break;
+            case 'P':
+                searchOptions.precisionPercent = parseDoubleArgument(optarg, "search precision");
+                break;
+            case 'C':
+                storeConfigFileName = std::string(optarg);
+                break;
+            case 'G':
+                storeSettings.emplace_back("cluster_clients", optarg);
+                break;
+            case 'U':
+                storeSettings.emplace_back("cluster_client_cpus", optarg);
+                break;
+            case 'K':
+                runnerPlacement = std::string(optarg);
+                break;
+            case 'Y':
+                workerPlacement = std::string(optarg);
+                break;
+            case 'x':
+            case 'X': {
+                std::string setting(optarg);
+                size_t separator = setting.find('=');
+                if ((separator == std::string::npos) || (separator == 0) || (separator == setting.size() - 1)) {
+                    std::cerr << "error: store parameter must be given as name=value: " << setting << std::endl;
+                    exit(1);
+                }
+                if (ch == 'x') {
+                    storeSettings.emplace_back(setting.substr(0, separator), setting.substr(separator + 1));
+                    break;
+                }
+                SweepParameter parameter;
+                parameter.name = setting.substr(0, separator);
+                std::stringstream values(setting.substr(separator + 1));
+                std::string value;
+                while (std::getline(values, value, ',')) {
+                    parameter.values.push_back(value);
+                }
+                sweep.push_back(parameter);
+                break;
+            }
+            case 'd':
+                try {
+                    openLoop.distribution = query_runner::arrivalDistributionFromString(optarg);
+                }
+                catch (std::runtime_error& e) {
+                    std::cerr << "error: " << e.what() << std::endl;
+                    exit(1);
+                }
+                break;
             case 'h':
                 usage(appName);
                 exit(0);
@@ -124,6 +1059,182 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    if (parseThreadCount < 1) {
+        std::cerr << "error: invalid parse thread count requested" << std::endl;
+        exit(1);
+    }
+
+    if ((processCount < 1) || (processIndex < 0) || (processIndex >= processCount)) {
+        std::cerr << "error: process index must be between 0 and process count - 1" << std::endl;
+        exit(1);
+    }
+    runnerOptions.processIndex = processIndex;
+    runnerOptions.processCount = processCount;
+
+    if (dynamicDispatch) {
+        if (mode == OperationMode::replicate) {
+            std::cerr << "error: dynamic dispatch cannot be combined with replicate mode" << std::endl;
+            exit(1);
+        }
+        mode = OperationMode::dynamic;
+    }
+
+    if (dispatchChunkSize < 1) {
+        std::cerr << "error: invalid dispatch chunk size requested" << std::endl;
+        exit(1);
+    }
+    runnerOptions.dispatchChunkSize = dispatchChunkSize;
+
+    if (maxInflight < 0) {
+        std::cerr << "error: invalid inflight count requested" << std::endl;
+        exit(1);
+    }
+    runnerOptions.maxInflight = maxInflight;
+
+    if ((virtualClients < 0) || (executorThreads < 0)) {
+        std::cerr << "error: invalid virtual client or executor thread count requested" << std::endl;
+        exit(1);
+    }
+    runnerOptions.virtualClients = virtualClients;
+    runnerOptions.executorThreads = executorThreads;
+
+    if (openLoop.rate < 0.0) {
+        std::cerr << "error: invalid rate requested" << std::endl;
+        exit(1);
+    }
+
+    if (runnerOptions.intervalSeconds < 0.0) {
+        std::cerr << "error: invalid interval requested" << std::endl;
+        exit(1);
+    }
+    if (!runnerOptions.intervalFile.empty() && (runnerOptions.intervalSeconds == 0.0)) {
+        std::cerr << "error: an interval file requires an interval (-I)" << std::endl;
+        exit(1);
+    }
+
+    if (runnerOptions.durationSeconds < 0.0) {
+        std::cerr << "error: invalid duration requested" << std::endl;
+        exit(1);
+    }
+    if ((runnerOptions.durationSeconds > 0.0) && (runnerOptions.replaySpeedup > 0.0)) {
+        std::cerr << "error: a duration cannot be combined with replay, the logged times do not repeat" << std::endl;
+        exit(1);
+    }
+
+    if ((plan.warmupSeconds < 0.0) || (warmupQueries < 0)) {
+        std::cerr << "error: invalid warmup requested" << std::endl;
+        exit(1);
+    }
+    if ((plan.warmupSeconds > 0.0) && (warmupQueries > 0)) {
+        std::cerr << "error: a warmup is bounded by either a duration (-W) or a query count (-w), not both" << std::endl;
+        exit(1);
+    }
+    if (((plan.warmupSeconds > 0.0) || (warmupQueries > 0)) && (runnerOptions.replaySpeedup > 0.0)) {
+        std::cerr << "error: a warmup cannot be combined with replay, the logged times do not repeat" << std::endl;
+        exit(1);
+    }
+    plan.warmupQueries = warmupQueries;
+
+    if (iterations < 1) {
+        std::cerr << "error: invalid iteration count requested" << std::endl;
+        exit(1);
+    }
+    plan.iterations = iterations;
+
+    if (workerProcesses < 0) {
+        std::cerr << "error: invalid worker process count requested" << std::endl;
+        exit(1);
+    }
+
+    // The environment first, read once the options are parsed so -h and
+    // usage errors need no Redis settings, then the config file, then the
+    // command line settings in order
+    try {
+        storeParams = RedisDataStore::getDefaultParams(false);
+        if (!storeConfigFileName.empty()) {
+            storeParams.loadConfigFile(storeConfigFileName);
+        }
+        for (const auto& setting : storeSettings) {
+            storeParams.set(setting.first, setting.second);
+        }
+        for (const auto& parameter : sweep) {
+            redis_store::RedisStoreParams checked = storeParams;
+            for (const auto& value : parameter.values) {
+                checked.set(parameter.name, value);
+                checked.valid();
+            }
+        }
+        storeParams.valid();
+    }
+    catch (redis_store::ConfigParamError& e) {
+        std::cerr << "error: " << e.what() << ", set REDIS_HOST, REDIS_PORT, REDIS_USER and REDIS_PASS or use -C or -x" << std::endl;
+        exit(1);
+    }
+    try {
+        if (!runnerPlacement.empty()) {
+            runnerOptions.runnerCpus = redis_store::parseCpuPlacement(runnerPlacement);
+        }
+        if (!workerPlacement.empty()) {
+            workerCpus = redis_store::parseCpuPlacement(workerPlacement);
+        }
+    }
+    catch (std::invalid_argument& e) {
+        std::cerr << "error: invalid placement: " << e.what() << std::endl;
+        exit(1);
+    }
+    if (!workerCpus.empty() && (workerProcesses == 0)) {
+        std::cerr << "error: a worker placement (-Y) requires worker processes (-p)" << std::endl;
+        exit(1);
+    }
+
+    if (!sweep.empty() && ((workerProcesses > 0) || !searchOptions.load.empty())) {
+        std::cerr << "error: a sweep cannot be combined with worker processes or a capacity search" << std::endl;
+        exit(1);
+    }
+
+    if (!searchOptions.load.empty()) {
+        if (searchOptions.p99SloMicro <= 0) {
+            std::cerr << "error: a capacity search requires a p99 SLO (-L)" << std::endl;
+            exit(1);
+        }
+        if ((searchOptions.precisionPercent <= 0.0) || (searchOptions.maxLoad < 0.0)) {
+            std::cerr << "error: invalid search max or precision requested" << std::endl;
+            exit(1);
+        }
+        if ((workerProcesses > 0) || (runnerOptions.replaySpeedup > 0.0)) {
+            std::cerr << "error: a capacity search cannot be combined with worker processes or replay" << std::endl;
+            exit(1);
+        }
+        if (searchOptions.load == "rate") {
+            if (openLoop.rate == 0.0) {
+                openLoop.rate = 1000.0;
+            }
+            if (searchOptions.maxLoad == 0.0) {
+                searchOptions.maxLoad = 1000000.0;
+            }
+        }
+        else if (searchOptions.maxLoad == 0.0) {
+            searchOptions.maxLoad = 1024.0;
+        }
+        if (searchOptions.maxLoad < ((searchOptions.load == "rate") ? openLoop.rate : threadCount)) {
+            std::cerr << "error: the search max is below the starting " << searchOptions.load << std::endl;
+            exit(1);
+        }
+    }
+
+    if ((runnerOptions.replaySpeedup > 0.0) && ((openLoop.rate > 0.0) || (runnerOptions.virtualClients > 0))) {
+        std::cerr << "error: replay cannot be combined with an open loop rate or virtual clients" << std::endl;
+        exit(1);
+    }
+
+    // Each virtual client sends its next query when the previous one
+    // completes, so it follows neither an arrival schedule nor a limit on
+    // the queries in flight
+    if ((runnerOptions.virtualClients > 0) && ((openLoop.rate > 0.0) || (runnerOptions.maxInflight > 0))) {
+        std::cerr << "error: virtual clients cannot be combined with an open loop rate, a rate search or an inflight limit" << std::endl;
+        exit(1);
+    }
+
     if (!fileExists(datafileName)) {
         std::cerr << "error: data file does not exist at: " << datafileName << std::endl;
         exit(1);
@@ -133,6 +1244,66 @@ int main(int argc, char* argv[]) {
     std::cout << "Running test with:" << std::endl;
     std::cout << "    datafile: " << datafileName << std::endl;
     std::cout << "    threadCount: " << std::to_string(threadCount) << std::endl;
+    std::cout << "    parseThreadCount: " << std::to_string(parseThreadCount) << std::endl;
+    if (!sharedMemoryName.empty()) {
+        std::cout << "    sharedMemory: " << sharedMemoryName << std::endl;
+    }
+    if (processCount > 1) {
+        std::cout << "    process: " << std::to_string(processIndex) << " of " << std::to_string(processCount) << std::endl;
+    }
+    if (workerProcesses > 0) {
+        std::cout << "    workerProcesses: " << std::to_string(workerProcesses) << std::endl;
+    }
+    if (runnerOptions.durationSeconds > 0.0) {
+        std::cout << "    duration: " << std::to_string(runnerOptions.durationSeconds) << " seconds" << std::endl;
+    }
+    if (plan.warmupSeconds > 0.0) {
+        std::cout << "    warmup: " << std::to_string(plan.warmupSeconds) << " seconds" << std::endl;
+    }
+    else if (plan.warmupQueries > 0) {
+        std::cout << "    warmup: " << std::to_string(plan.warmupQueries) << " queries" << std::endl;
+    }
+    if (searchOptions.load.empty()) {
+        std::cout << "    iterations: " << std::to_string(plan.iterations) << std::endl;
+    }
+    else {
+        std::cout << "    search: " << searchOptions.load << " up to " << std::to_string(searchOptions.maxLoad) << ", p99 SLO "
+                  << std::to_string(searchOptions.p99SloMicro) << " microseconds" << std::endl;
+    }
+    if (openLoop.rate > 0.0) {
+        std::cout << "    openLoopRate: " << std::to_string(openLoop.rate) << " queries/second, "
+                  << query_runner::arrivalDistributionToString(openLoop.distribution) << " arrivals" << std::endl;
+    }
+    if (runnerOptions.replaySpeedup > 0.0) {
+        std::cout << "    replay: " << std::to_string(runnerOptions.replaySpeedup) << "x logged query times" << std::endl;
+    }
+    if (runnerOptions.virtualClients > 0) {
+        std::cout << "    resultApi: async, virtualClients: " << std::to_string(runnerOptions.virtualClients) << std::endl;
+    }
+    else if (runnerOptions.maxInflight > 0) {
+        std::cout << "    resultApi: async, inflight: " << std::to_string(runnerOptions.maxInflight) << std::endl;
+    }
+    else {
+        std::cout << "    resultApi: " << query_runner::resultApiToString(runnerOptions.resultApi) << std::endl;
+    }
+    std::cout << "    nodeBatching: " << (storeParams.batchByNode ? "true" : "false") << std::endl;
+    std::cout << "    stageTiming: " << (storeParams.timeFetchStages ? "true" : "false") << std::endl;
+    std::cout << "    poolSize: " << std::to_string(storeParams.poolSize)
+              << ", maxMultiKeyBatchSize: " << std::to_string(storeParams.maxMultiKeyBatchSize) << std::endl;
+    if (storeParams.clusterClients > 1) {
+        std::cout << "    clusterClients: " << std::to_string(storeParams.clusterClients) << std::endl;
+    }
+    std::vector<int> numaNodes = redis_store::getNumaNodes();
+    std::cout << "    numaNodes: " << (numaNodes.empty() ? std::string("unknown") : redis_store::formatCpuList(numaNodes)) << std::endl;
+    std::cout << "    placement: runners " << (runnerPlacement.empty() ? "unpinned" : runnerPlacement) << ", event loops "
+              << (storeParams.clusterClientCpus.empty() ? "unpinned" : storeParams.clusterClientCpus);
+    if (workerProcesses > 0) {
+        std::cout << ", workers " << (workerPlacement.empty() ? "unpinned" : workerPlacement);
+    }
+    std::cout << std::endl;
+    for (const auto& parameter : sweep) {
+        std::cout << "    sweep: " << parameter.name << " over " << std::to_string(parameter.values.size()) << " values" << std::endl;
+    }
     switch (mode) {
         case OperationMode::divide:
             std::cout << "    mode: divide" << std::endl;
@@ -140,28 +1311,108 @@ int main(int argc, char* argv[]) {
         case OperationMode::replicate:
             std::cout << "    mode: replicate" << std::endl;
             break;
+        case OperationMode::dynamic:
+            std::cout << "    mode: dynamic, chunk size: " << std::to_string(runnerOptions.dispatchChunkSize) << std::endl;
+            break;
     }
     std::cout << std::endl;
 
     QueryListCollector collector(threadCount, mode);
-    collector.parseCsvIntoBuckets(datafileName);
+    collector.setProcessSlice(processIndex, processCount);
+    collector.setCsvQueryTimes(csvQueryTimes);
+    try {
+        if (sharedMemoryName.empty()) {
+            collector.loadIntoBuckets(datafileName, parseThreadCount);
+        }
+        else {
+            collector.loadSharedIntoBuckets(datafileName, sharedMemoryName, parseThreadCount);
+        }
+    }
+    catch (std::runtime_error& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        exit(1);
+    }
 
-    std::cout << std::endl;
+    if ((runnerOptions.replaySpeedup > 0.0) && !collector.getWorkload()->hasQueryTimes()) {
+        std::cerr << "error: replay requires query times, load a csv file with -T or a binary file compiled from one" << std::endl;
+        exit(1);
+    }
 
-    std::shared_ptr<RedisDataStore> redisStore = RedisDataStore::factory();
+    std::cout << std::endl;
 
-    // Testing Cluster Slots get
-    // redisStore->getClusterSlots();
-    // exit(0);
+    Json::Value results;
+    results["config"] = makeConfigJson(datafileName, threadCount, mode, processIndex, processCount, storeParams, runnerOptions);
+    results["config"]["warmup_seconds"] = plan.warmupSeconds;
+    results["config"]["warmup_queries"] = (Json::UInt64)plan.warmupQueries;
+    results["config"]["iterations"] = plan.iterations;
+    results["config"]["placement"]["runners"] = runnerPlacement;
+    results["config"]["placement"]["event_loops"] = storeParams.clusterClientCpus;
+    results["config"]["placement"]["workers"] = workerPlacement;
+    results["config"]["placement"]["numa_nodes"] = redis_store::formatCpuList(numaNodes);
 
-    std::string testName = "run1";
-    doTestRun(testName, threadCount, collector, redisStore);
+    Json::Value runs(Json::arrayValue);
+    if (!searchOptions.load.empty()) {
+        results["config"]["search_p99_slo_us"] = (Json::Int64)searchOptions.p99SloMicro;
+        results["search"] = runCapacitySearch(threadCount, collector, storeParams, runnerOptions, plan, searchOptions, runs);
+    }
+    else if (!sweep.empty()) {
+        results["sweep"] = runSweep(threadCount, collector, storeParams, runnerOptions, plan, sweep, runs);
+    }
+    else if (workerProcesses == 0) {
+        runs = runTests(threadCount, collector, storeParams, runnerOptions, plan, nullptr);
+    }
+    else {
+        // Every worker takes its own slice of this process's share of the
+        // workload, and connects to redis after the fork
+        results["config"]["worker_processes"] = workerProcesses;
+        try {
+            WorkerGroup workers(workerProcesses);
+            workers.start([&](unsigned int workerIndex) {
+                // Set before any thread starts, every thread of the worker
+                // inherits it
+                if (!workerCpus.empty()) {
+                    std::vector<int> cpus = workerCpus[workerIndex % workerCpus.size()];
+                    redis_store::setThreadAffinity(cpus);
+                    std::cout << "Worker " << std::to_string(workerIndex) << " pinned to CPUs " << redis_store::formatCpuList(cpus) << std::endl;
+                }
+                RunnerOptions workerOptions = runnerOptions;
+                workerOptions.processIndex = (processIndex * workerProcesses) + workerIndex;
+                workerOptions.processCount = processCount * workerProcesses;
+                collector.setProcessSlice(workerOptions.processIndex, workerOptions.processCount);
+                runTests(threadCount, collector, storeParams, workerOptions, plan, &workers);
+                return 0;
+            });
+            if (!workers.wait()) {
+                exit(1);
+            }
+            std::cout << std::endl;
+            runs = mergeWorkerResults(workers);
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << std::endl;
+            exit(1);
+        }
+    }
 
-    std::cout << std::endl;
-    std::cout << std::endl;
+    // The warmup is kept apart so it is never combined with measured runs
+    results["runs"] = Json::Value(Json::arrayValue);
+    for (const auto& run : runs) {
+        if (run["warmup"].asBool()) {
+            results["warmup"] = run;
+        }
+        else {
+            results["runs"].append(run);
+        }
+    }
+    // Probe runs are at different loads, their spread is the latency curve
+    if ((results["runs"].size() > 1) && searchOptions.load.empty() && sweep.empty()) {
+        results["summary"] = printIterationSummary(results["runs"]);
+    }
 
-    testName = "run2";
-    doTestRun(testName, threadCount, collector, redisStore);
+    if (!resultsFileName.empty()) {
+        writeResultsJson(resultsFileName, results);
+        std::cout << "Results written to " << resultsFileName << std::endl;
+    }
 
     std::cout << "Tests complete" << std::endl;
     return 0;
@@ -0,0 +1,142 @@
+#include <redis_workload/run_results.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using redis_store::LatencyHistogram;
+
+namespace query_runner {
+
+RunResults::RunResults(const std::string& name) :
+    name_(name) {}
+
+static void mergeHistogram(LatencyHistogram& histogram, const Json::Value& summary) {
+    if (!summary.isObject() || !summary.isMember("histogram")) {
+        return;
+    }
+    histogram.merge(LatencyHistogram::deserialize(summary["histogram"].asString()));
+}
+
+void RunResults::add(const Json::Value& runResult) {
+    if (name_.empty()) {
+        name_ = runResult["name"].asString();
+    }
+    try {
+        mergeHistogram(queryTimes_, runResult["query_times"]);
+        mergeHistogram(serviceTimes_, runResult["service_times"]);
+    }
+    catch (std::exception& e) {
+        // deserialize throws runtime_error for a malformed histogram, merge
+        // invalid_argument for mismatched ranges, JsonCpp a non-string one
+        throw std::runtime_error(std::string("Cannot combine the results of ") + name_ + ": " + e.what());
+    }
+
+    // Combined results count as the number of results they hold
+    resultCount_ += runResult.isMember("results") ? runResult["results"].asUInt64() : 1;
+    queries_ += runResult["queries"].asUInt64();
+    successes_ += runResult["successes"].asUInt64();
+    queriesPerSecond_ += runResult["queries_per_second"].asDouble();
+    maxRuntimeMilliseconds_ = std::max<long long>(maxRuntimeMilliseconds_, runResult["runtime_ms"].asInt64());
+}
+
+std::string RunResults::toString(const std::string& label) const {
+    std::stringstream sstream;
+    sstream << label << ": " << std::to_string(resultCount_) << " results, " << std::to_string(queries_) << " queries, "
+            << std::to_string(queries_ - successes_) << " errors, " << std::to_string(queriesPerSecond_) << " queries/s" << std::endl;
+    sstream << queryTimes_.toString("      ", label + " query times");
+    if (serviceTimes_.getTotalCount() > 0) {
+        sstream << serviceTimes_.toString("      ", label + " service times");
+    }
+    return sstream.str();
+}
+
+Json::Value RunResults::toJson() const {
+    Json::Value result;
+    result["name"] = name_;
+    result["results"] = (Json::UInt64)resultCount_;
+    result["queries"] = (Json::UInt64)queries_;
+    result["successes"] = (Json::UInt64)successes_;
+    result["queries_per_second"] = queriesPerSecond_;
+    result["runtime_ms"] = (Json::Int64)maxRuntimeMilliseconds_;
+    result["query_times"] = queryTimes_.toJson();
+    if (serviceTimes_.getTotalCount() > 0) {
+        result["service_times"] = serviceTimes_.toJson();
+    }
+    return result;
+}
+
+/**
+ * Two sided 95% critical value of the Student t distribution.
+ *
+ * @param degreesOfFreedom the number of values - 1, at least 1
+ */
+static double studentT95(size_t degreesOfFreedom) {
+    static const double kCriticalValues[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                             2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                             2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    static const size_t kTableSize = sizeof(kCriticalValues) / sizeof(kCriticalValues[0]);
+
+    if (degreesOfFreedom <= kTableSize) {
+        return kCriticalValues[degreesOfFreedom - 1];
+    }
+    if (degreesOfFreedom <= 40) {
+        return 2.021;
+    }
+    if (degreesOfFreedom <= 60) {
+        return 2.000;
+    }
+    if (degreesOfFreedom <= 120) {
+        return 1.980;
+    }
+    return 1.960;
+}
+
+iteration_summary_t summarizeIterations(const std::vector<double>& values) {
+    iteration_summary_t summary;
+    summary.count = values.size();
+    if (values.empty()) {
+        return summary;
+    }
+
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    summary.mean = sum / (double)values.size();
+    if (values.size() < 2) {
+        return summary;
+    }
+
+    double squaredDeviations = 0.0;
+    for (double value : values) {
+        squaredDeviations += (value - summary.mean) * (value - summary.mean);
+    }
+    summary.stddev = std::sqrt(squaredDeviations / (double)(values.size() - 1));
+    summary.confidence95 = studentT95(values.size() - 1) * summary.stddev / std::sqrt((double)values.size());
+    return summary;
+}
+
+std::string iterationSummaryToString(const iteration_summary_t& summary, const std::string& unit) {
+    double relativeStddev = (summary.mean != 0.0) ? (100.0 * summary.stddev / summary.mean) : 0.0;
+    std::stringstream sstream;
+    sstream << "mean " << std::to_string(summary.mean) << " " << unit << ", stddev " << std::to_string(summary.stddev) << " ("
+            << std::to_string(relativeStddev) << "%), 95% CI +/- " << std::to_string(summary.confidence95) << " ("
+            << std::to_string(summary.mean - summary.confidence95) << " to " << std::to_string(summary.mean + summary.confidence95) << ")";
+    return sstream.str();
+}
+
+Json::Value iterationSummaryToJson(const iteration_summary_t& summary) {
+    Json::Value json;
+    json["iterations"] = (Json::UInt64)summary.count;
+    json["mean"] = summary.mean;
+    json["stddev"] = summary.stddev;
+    json["variance"] = summary.stddev * summary.stddev;
+    json["ci95_low"] = summary.mean - summary.confidence95;
+    json["ci95_high"] = summary.mean + summary.confidence95;
+    return json;
+}
+
+}  // namespace query_runner
@@ -1,6 +1,9 @@
+#include <redis_workload/crc16.h>
 #include <redis_workload/util.h>
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <redis_workload/remove_duplicates.hpp>
 #include <string>
 
@@ -45,28 +48,62 @@ std::pair<std::string, int> getRedisHostFromEnv() {
     return std::make_pair(host, port);
 }
 
-void groupKeysByRedisHashslot(vector_keys_t& keys, hashslot_key_groups_t& hashslotGroups) {
-    RedisHashSlotGenerator* hashSlotGenerator = getRedisHashslotGenerator();
+void HashslotKeyGroups::group(std::span<const hashslot_key_t> keys) {
+    sortedKeys_.clear();
+    for (size_t i = 0; i < keys.size(); i++) {
+        sortedKeys_.push_back({keys[i], (uint32_t)i});
+    }
+    groupSortedKeys();
+}
 
-    removeDuplicates(keys);
+void HashslotKeyGroups::group(std::span<const std::string_view> keys) {
+    RedisHashSlotGenerator* hashSlotGenerator = getRedisHashslotGenerator();
 
-    for (const std::string& k : keys) {
-        uint16_t hashSlot = hashSlotGenerator->getHashslotForKey(k);
+    sortedKeys_.clear();
+    for (size_t i = 0; i < keys.size(); i++) {
+        sortedKeys_.push_back({{keys[i], hashSlotGenerator->getHashslotForKey(keys[i])}, (uint32_t)i});
+    }
+    groupSortedKeys();
+}
 
-        if (auto it {hashslotGroups.find(hashSlot)}; it != std::end(hashslotGroups)) {
-            // hashslotGroup already exists, so just append the new key to the
-            // existing hashslot vector
-            it->second.push_back(k);
-        }
-        else {
-            // This is a new hashslot so extend the hashslotGroups map by adding a new
-            // vector
-            vector_keys_t newHashslotKeys = {k};
-            hashslotGroups.insert(std::pair<uint16_t, vector_keys_t>(hashSlot, newHashslotKeys));
+void HashslotKeyGroups::groupSortedKeys() {
+    // Sorting by hashslot first makes every group a contiguous run, and
+    // duplicate keys adjacent within their group
+    std::sort(sortedKeys_.begin(), sortedKeys_.end(), [](const positioned_key_t& a, const positioned_key_t& b) {
+        return (a.key.hashslot != b.key.hashslot) ? (a.key.hashslot < b.key.hashslot) : (a.key.key < b.key.key);
+    });
+
+    // Reserving up front keeps the group spans valid while groupedKeys_ grows
+    groupedKeys_.clear();
+    groupedKeys_.reserve(sortedKeys_.size());
+    groups_.clear();
+    keyIndexByPosition_.resize(sortedKeys_.size());
+
+    for (const positioned_key_t& k : sortedKeys_) {
+        if (groupedKeys_.empty() || (groupedKeys_.back() != k.key.key)) {
+            if (groups_.empty() || (groups_.back().hashslot != k.key.hashslot)) {
+                groups_.push_back({k.key.hashslot, std::span<const std::string_view>(groupedKeys_.data() + groupedKeys_.size(), 0)});
+            }
+            groupedKeys_.push_back(k.key.key);
+            groups_.back().keys = std::span<const std::string_view>(groups_.back().keys.data(), groups_.back().keys.size() + 1);
         }
+        keyIndexByPosition_[k.position] = (uint32_t)(groupedKeys_.size() - 1);
     }
 }
 
+HashslotKeyGroups& getThreadHashslotKeyGroups() {
+    static thread_local HashslotKeyGroups hashslotGroups;
+    return hashslotGroups;
+}
+
+void groupKeysByRedisHashslot(const vector_key_views_t& keys, HashslotKeyGroups& hashslotGroups) {
+    hashslotGroups.group(std::span<const std::string_view>(keys));
+}
+
+void groupKeysByRedisHashslot(const vector_hashslot_keys_t& keys, HashslotKeyGroups& hashslotGroups) {
+    hashslotGroups.group(std::span<const hashslot_key_t>(keys));
+}
+
 std::string getKeyForFeatureID(const std::string& redisKeyPrefix, const std::string& redisKeySuffix, const std::string& featureID) {
     return (redisKeyPrefix + featureID + redisKeySuffix);
 }
@@ -75,7 +112,7 @@ std::string getKeyForFeatureID(const std::string& redisKeyPrefix, const std::str
     return getKeyForFeatureID(redisKeyPrefix, redisKeySuffix, std::to_string(featureID));
 }
 
-std::string getFeatureIDFromKey(const std::string& redisKeyPrefix, const std::string& redisKeySuffix, const std::string& key) {
+std::string_view getFeatureIDFromKey(const std::string& redisKeyPrefix, const std::string& redisKeySuffix, std::string_view key) {
     static const size_t prefix_length = redisKeyPrefix.size();
     static const size_t suffix_length = redisKeySuffix.size();
     return key.substr(prefix_length, key.size() - prefix_length - suffix_length);
@@ -88,12 +125,12 @@ std::string getFeatureIDFromKey(const std::string& redisKeyPrefix, const std::st
  *
  * @return the generated checksum value.
  */
-uint16_t SingletonRedisHashSlotGenerator::crc16(const std::string& data) {
+uint16_t SingletonRedisHashSlotGenerator::crc16(std::string_view data) {
     // Treat this entire method as a critical section
     std::lock_guard<std::mutex> guard(this->mutex);
     // Ensure crc generator is reset to initial state
     crc_ccitt.reset(redisHashslotInitialRem);
-    crc_ccitt.process_bytes(data.c_str(), data.length());
+    crc_ccitt.process_bytes(data.data(), data.length());
 
     return crc_ccitt.checksum();
 }
@@ -105,7 +142,7 @@ uint16_t SingletonRedisHashSlotGenerator::crc16(const std::string& data) {
  *
  * @return the generated checksum value.
  */
-uint16_t EphemeralRedisHashSlotGenerator::crc16(const std::string& data) {
+uint16_t EphemeralRedisHashSlotGenerator::crc16(std::string_view data) {
     boost::crc_optimal<redisHashslotCRCBitWidth,
                        redisHashslotCRCPoly,
                        redisHashslotInitialRem,
@@ -114,7 +151,7 @@ uint16_t EphemeralRedisHashSlotGenerator::crc16(const std::string& data) {
                        redisHashslotReflectOutput>
         crc_ccitt;
 
-    crc_ccitt.process_bytes(data.c_str(), data.length());
+    crc_ccitt.process_bytes(data.data(), data.length());
     return crc_ccitt.checksum();
 }
 
@@ -125,8 +162,30 @@ uint16_t EphemeralRedisHashSlotGenerator::crc16(const std::string& data) {
  *
  * @return the generated checksum value.
  */
-uint16_t RedisPlusPlusHashSlotGenerator::crc16(const std::string& data) {
-    return sw::redis::crc16(data.c_str(), data.length());
+uint16_t RedisPlusPlusHashSlotGenerator::crc16(std::string_view data) {
+    return sw::redis::crc16(data.data(), static_cast<int>(data.length()));
+}
+
+/**
+ * Calculate a CCITT CRC16 hash using slicing-by-8 lookup tables.
+ *
+ * @param data the data to calculate the CRC for.
+ *
+ * @return the generated checksum value.
+ */
+uint16_t TableRedisHashSlotGenerator::crc16(std::string_view data) {
+    return crc16SliceBy8(data.data(), data.length());
+}
+
+/**
+ * Calculate a CCITT CRC16 hash using carry-less multiplication.
+ *
+ * @param data the data to calculate the CRC for.
+ *
+ * @return the generated checksum value.
+ */
+uint16_t ClmulRedisHashSlotGenerator::crc16(std::string_view data) {
+    return crc16Clmul(data.data(), data.length());
 }
 
 /**
@@ -139,10 +198,11 @@ uint16_t RedisPlusPlusHashSlotGenerator::crc16(const std::string& data) {
  *
  * @param key Redis key string.
  *
- * @return the string to be used to calculate the corresponding hashslot.
+ * @return the string to be used to calculate the corresponding hashslot,
+ *         as a view into key.
  */
-std::string RedisHashSlotGenerator::getRedisHashtag(const std::string& key) {
-    if (key == "") {
+std::string_view RedisHashSlotGenerator::getRedisHashtag(std::string_view key) {
+    if (key.empty()) {
         throw std::invalid_argument("key must be a non-empty string");
     }
 
@@ -161,7 +221,7 @@ std::string RedisHashSlotGenerator::getRedisHashtag(const std::string& key) {
 
     std::size_t closeBracePos = key.find('}', openBracePos) - openBracePos;
 
-    std::string hashtag;
+    std::string_view hashtag;
     if (closeBracePos != std::string::npos) {
         hashtag = key.substr(openBracePos + 1, closeBracePos - 1);
         if (hashtag.length() > 0)
@@ -187,7 +247,7 @@ static const uint16_t redisHashslotMax = 16383;
  *
  * @return the hashslot identifier.
  */
-uint16_t RedisHashSlotGenerator::getHashslotForKey(const std::string& key) {
+uint16_t RedisHashSlotGenerator::getHashslotForKey(std::string_view key) {
     /*
      * Calculation of the hashslot should follow the hashtag algorithm
      * described at https://redis.io/docs/reference/cluster-spec/
@@ -202,21 +262,77 @@ uint16_t RedisHashSlotGenerator::getHashslotForKey(const std::string& key) {
     return this->crc16(getRedisHashtag(key)) & redisHashslotMax;
 }
 
+std::string crcEngineToString(CrcEngine engine) {
+    switch (engine) {
+        case CrcEngine::clmul:
+            return "clmul";
+        case CrcEngine::table:
+            return "table";
+        case CrcEngine::redisPlusPlus:
+            return "redis++";
+        case CrcEngine::singleton:
+            return "singleton";
+        case CrcEngine::ephemeral:
+            return "ephemeral";
+    }
+    return "unknown";
+}
+
+static CrcEngine selectRedisHashslotCrcEngine() {
+    CrcEngine engine = crc16ClmulSupported() ? CrcEngine::clmul : CrcEngine::table;
+
+    std::string requested = getEnvVar("REDIS_CRC_ENGINE");
+    if (!requested.empty()) {
+        bool found = false;
+        for (CrcEngine e : {CrcEngine::clmul, CrcEngine::table, CrcEngine::redisPlusPlus, CrcEngine::singleton, CrcEngine::ephemeral}) {
+            if (requested == crcEngineToString(e)) {
+                engine = e;
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "warn: ignoring unknown REDIS_CRC_ENGINE: " << requested << std::endl;
+        }
+        else if ((engine == CrcEngine::clmul) && !crc16ClmulSupported()) {
+            std::cerr << "warn: CPU does not support the clmul CRC engine, using table" << std::endl;
+            engine = CrcEngine::table;
+        }
+    }
+
+    std::cout << "Using CRC engine: " << crcEngineToString(engine) << std::endl;
+    return engine;
+}
+
+CrcEngine getRedisHashslotCrcEngine() {
+    static const CrcEngine engine = selectRedisHashslotCrcEngine();
+    return engine;
+}
+
+static RedisHashSlotGenerator* makeRedisHashslotGenerator() {
+    switch (getRedisHashslotCrcEngine()) {
+        case CrcEngine::clmul:
+            return new ClmulRedisHashSlotGenerator();
+        case CrcEngine::table:
+            return new TableRedisHashSlotGenerator();
+        case CrcEngine::redisPlusPlus:
+            return new RedisPlusPlusHashSlotGenerator();
+        case CrcEngine::singleton:
+            return new SingletonRedisHashSlotGenerator();
+        case CrcEngine::ephemeral:
+            return new EphemeralRedisHashSlotGenerator();
+    }
+    return new TableRedisHashSlotGenerator();
+}
+
 /**
- * Factory to return appropriate hashslot generator based on compile-time
- * settings
+ * Factory to return appropriate hashslot generator based on the CPU
+ * features and the REDIS_CRC_ENGINE environment variable. The generator
+ * is created on first use and shared by all callers.
  * @return the hashslot generator instance
  */
 RedisHashSlotGenerator* getRedisHashslotGenerator() {
-    RedisHashSlotGenerator* generator;
-#if defined(USE_REDIS_PLUS_PLUS_CRC_ENGINE)
-    generator = new RedisPlusPlusHashSlotGenerator();
-#elif defined(USE_EPHEMERAL_CRC_ENGINE)
-    generator = new EphemeralRedisHashSlotGenerator();
-#else
-    generator = new SingletonRedisHashSlotGenerator();
-#endif
-    return generator;
+    static const std::unique_ptr<RedisHashSlotGenerator> generator(makeRedisHashslotGenerator());
+    return generator.get();
 }
 
 /**
@@ -277,4 +393,16 @@ double findAverage(std::vector<long long>* data) {
     return average;
 }
 
+size_t countFetchedObjects(const vector_results_t& results, size_t& fetchedBytes) {
+    size_t fetchedCount = 0;
+    fetchedBytes = 0;
+    for (const sw::redis::OptionalString& result : results) {
+        if (result.has_value()) {
+            fetchedCount++;
+            fetchedBytes += result->size();
+        }
+    }
+    return fetchedCount;
+}
+
 }  // namespace redis_store
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include <redis_workload/worker_group.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace query_runner {
+
+// Each results area starts on its own page
+static size_t pageAlign(size_t size) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+WorkerGroup::WorkerGroup(unsigned int workerCount, size_t resultCapacity) :
+    workerCount_(workerCount),
+    resultCapacity_(pageAlign(resultCapacity)) {
+    if (workerCount_ < 1) {
+        throw std::runtime_error("A worker group needs at least one worker");
+    }
+
+    mappingSize_ = pageAlign(sizeof(shared_state_t)) + (workerCount_ * resultCapacity_);
+    mapping_ = mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Could not map worker shared memory: " + std::string(strerror(errno)));
+    }
+
+    pthread_barrierattr_t attributes;
+    pthread_barrierattr_init(&attributes);
+    pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    int error = pthread_barrier_init(&getSharedState()->barrier, &attributes, workerCount_);
+    pthread_barrierattr_destroy(&attributes);
+    if (error != 0) {
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+        throw std::runtime_error("Could not create worker barrier: " + std::string(strerror(error)));
+    }
+}
+
+WorkerGroup::~WorkerGroup() {
+    // The barrier is not destroyed: it holds nothing beyond the mapping, and
+    // destroying it waits forever for a worker killed at the barrier
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mappingSize_);
+    }
+}
+
+WorkerGroup::shared_state_t* WorkerGroup::getSharedState() {
+    return static_cast<shared_state_t*>(mapping_);
+}
+
+WorkerGroup::result_area_t* WorkerGroup::getResultArea(unsigned int workerIndex) {
+    char* areas = static_cast<char*>(mapping_) + pageAlign(sizeof(shared_state_t));
+    return reinterpret_cast<result_area_t*>(areas + (workerIndex * resultCapacity_));
+}
+
+void WorkerGroup::start(const std::function<int(unsigned int)>& workerMain) {
+    // Output buffered before the fork would be written by every worker
+    std::cout.flush();
+    std::cerr.flush();
+
+    for (unsigned int i = 0; i < workerCount_; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::string error = strerror(errno);
+            for (pid_t worker : workerPids_) {
+                kill(worker, SIGTERM);
+            }
+            throw std::runtime_error("Could not fork worker " + std::to_string(i) + ": " + error);
+        }
+        if (pid == 0) {
+            workerIndex_ = (int)i;
+            workerPids_.clear();
+            int status = 1;
+            try {
+                status = workerMain(i);
+            }
+            catch (std::exception& e) {
+                std::cerr << "error: worker " << std::to_string(i) << ": " << e.what() << std::endl;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            // Skip the destructors of objects inherited from the parent
+            _exit(status);
+        }
+        workerPids_.push_back(pid);
+    }
+}
+
+void WorkerGroup::arriveAndWait() {
+    pthread_barrier_wait(&getSharedState()->barrier);
+}
+
+void WorkerGroup::appendResult(const std::string& result) {
+    result_area_t* area = getResultArea(workerIndex_);
+    size_t capacity = resultCapacity_ - sizeof(result_area_t);
+    if (area->size + result.size() + 1 > capacity) {
+        throw std::runtime_error("Worker results exceed the " + std::to_string(capacity) + " byte results area");
+    }
+    char* data = reinterpret_cast<char*>(area + 1);
+    memcpy(data + area->size, result.data(), result.size());
+    data[area->size + result.size()] = '\n';
+    area->size += result.size() + 1;
+}
+
+bool WorkerGroup::wait() {
+    bool success = true;
+    size_t remaining = workerPids_.size();
+    while (remaining > 0) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        unsigned int worker = 0;
+        while ((worker < workerPids_.size()) && (workerPids_[worker] != pid)) {
+            worker++;
+        }
+        if (worker == workerPids_.size()) {
+            continue;
+        }
+        workerPids_[worker] = 0;
+        remaining--;
+
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            if (success) {
+                std::cerr << "error: worker " << std::to_string(worker) << " failed, stopping the other workers" << std::endl;
+                for (pid_t other : workerPids_) {
+                    if (other != 0) {
+                        kill(other, SIGTERM);
+                    }
+                }
+            }
+            success = false;
+        }
+    }
+    workerPids_.clear();
+    return success;
+}
+
+std::vector<std::string> WorkerGroup::getResults(unsigned int workerIndex) {
+    std::vector<std::string> results;
+    result_area_t* area = getResultArea(workerIndex);
+    std::string_view data(reinterpret_cast<const char*>(area + 1), area->size);
+    while (!data.empty()) {
+        size_t newline = data.find('\n');
+        results.emplace_back(data.substr(0, newline));
+        data.remove_prefix((newline == std::string_view::npos) ? data.size() : newline + 1);
+    }
+    return results;
+}
+
+unsigned int WorkerGroup::getWorkerCount() const {
+    return workerCount_;
+}
+
+int WorkerGroup::getWorkerIndex() const {
+    return workerIndex_;
+}
+
+}  // namespace query_runner
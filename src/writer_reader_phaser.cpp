@@ -0,0 +1,29 @@
+#include <redis_workload/writer_reader_phaser.h>
+
+#include <thread>
+
+namespace redis_store {
+
+void WriterReaderPhaser::flipPhase() {
+    // The sign of startEpoch_ tells writers which end counter to increment
+    bool nextPhaseIsEven = (startEpoch_.load() < 0);
+
+    int64_t initialStartValue = nextPhaseIsEven ? 0 : INT64_MIN;
+    if (nextPhaseIsEven) {
+        evenEndEpoch_.store(initialStartValue);
+    }
+    else {
+        oddEndEpoch_.store(initialStartValue);
+    }
+
+    int64_t startValueAtFlip = startEpoch_.exchange(initialStartValue);
+
+    // Every writer that entered before the exchange increments the end
+    // counter of the previous phase when it leaves
+    std::atomic<int64_t>& previousEndEpoch = nextPhaseIsEven ? oddEndEpoch_ : evenEndEpoch_;
+    while (previousEndEpoch.load() != startValueAtFlip) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace redis_store